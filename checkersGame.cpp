@@ -1,529 +1,6782 @@
-//
-// Created by BE129 on 11/19/2025.
-//
-
-
-
-#include <iostream>
-#include <vector>
-#include <cmath>
-#include <algorithm>
-#include <limits> // Required for input clearing
-
-// --- 1. ENUMS AND CONSTANTS ---
-
-// Define the two players
-enum Player {
-    NONE = 0,
-    RED = 1,  // Starts at the bottom of the board (Rows 5, 6, 7)
-    BLACK = 2 // Starts at the top of the board (Rows 0, 1, 2)
-};
-
-// Define the possible states of a square on the board
-enum SquareType {
-    EMPTY,
-    RED_PIECE,
-    BLACK_PIECE,
-    RED_KING,
-    BLACK_KING
-};
-
-const int BOARD_SIZE = 8;
-const char PIECE_SYMBOLS[] = {' ', 'R', 'B', 'K', 'k'}; // Corresponding symbols for display
-
-// --- 2. PIECE CLASS ---
-
-/**
- * @class Piece
- * @brief Represents a single checker on the board.
- */
-class Piece {
-public:
-    Player owner;
-    bool isKing;
-    int row;
-    int col;
-
-    Piece(Player p, int r, int c) : owner(p), isKing(false), row(r), col(c) {}
-
-    // Default constructor for placeholder, should generally not be used
-    Piece() : owner(NONE), isKing(false), row(-1), col(-1) {}
-
-    // Convert the piece state to a displayable symbol
-    char getSymbol() const {
-        if (owner == NONE) return ' ';
-        if (isKing) {
-            return (owner == RED) ? PIECE_SYMBOLS[RED_KING] : PIECE_SYMBOLS[BLACK_KING];
-        } else {
-            return (owner == RED) ? PIECE_SYMBOLS[RED_PIECE] : PIECE_SYMBOLS[BLACK_PIECE];
-        }
-    }
-
-    // Promote the piece to a King
-    void makeKing() {
-        isKing = true;
-    }
-
-    // Update the piece's position
-    void setPosition(int r, int c) {
-        row = r;
-        col = c;
-    }
-};
-
-// --- 3. BOARD CLASS ---
-
-/**
- * @class Board
- * @brief Manages the 8x8 game grid and piece placement.
- */
-class Board {
-private:
-    // 8x8 grid holding pointers to Piece objects
-    Piece* grid[BOARD_SIZE][BOARD_SIZE];
-
-public:
-    Board() {
-        // Initialize the grid to be all empty pointers (nullptr)
-        for (int i = 0; i < BOARD_SIZE; ++i) {
-            for (int j = 0; j < BOARD_SIZE; ++j) {
-                grid[i][j] = nullptr;
-            }
-        }
-    }
-
-    // Destructor to clean up dynamically allocated pieces
-    ~Board() {
-        for (int i = 0; i < BOARD_SIZE; ++i) {
-            for (int j = 0; j < BOARD_SIZE; ++j) {
-                delete grid[i][j];
-                grid[i][j] = nullptr;
-            }
-        }
-    }
-
-    // Sets up the board with 12 pieces for each player
-    void initializeBoard() {
-        // Clear any existing pieces
-        for (int i = 0; i < BOARD_SIZE; ++i) {
-            for (int j = 0; j < BOARD_SIZE; ++j) {
-                delete grid[i][j];
-                grid[i][j] = nullptr;
-            }
-        }
-
-        // BLACK pieces (start at top, rows 0, 1, 2)
-        for (int r = 0; r < 3; ++r) {
-            for (int c = 0; c < BOARD_SIZE; ++c) {
-                // Pieces are only placed on "dark" squares (row + col is odd)
-                if ((r + c) % 2 != 0) {
-                    grid[r][c] = new Piece(BLACK, r, c);
-                }
-            }
-        }
-
-        // RED pieces (start at bottom, rows 5, 6, 7)
-        for (int r = 5; r < BOARD_SIZE; ++r) {
-            for (int c = 0; c < BOARD_SIZE; ++c) {
-                if ((r + c) % 2 != 0) {
-                    grid[r][c] = new Piece(RED, r, c);
-                }
-            }
-        }
-    }
-
-    // Prints the current state of the board to the console
-    void displayBoard() const {
-        std::cout << "\n    A B C D E F G H (Columns)" << std::endl;
-        std::cout << "  -----------------" << std::endl;
-        for (int i = 0; i < BOARD_SIZE; ++i) {
-            std::cout << i + 1 << " |"; // Row number (1-8)
-            for (int j = 0; j < BOARD_SIZE; ++j) {
-                if (grid[i][j]) {
-                    std::cout << " " << grid[i][j]->getSymbol();
-                } else {
-                    // Only show a marker for playable (dark) squares
-                    if ((i + j) % 2 != 0) {
-                         std::cout << " ."; // Playable empty square
-                    } else {
-                         std::cout << "  "; // Unplayable square
-                    }
-                }
-            }
-            std::cout << " |" << std::endl;
-        }
-        std::cout << "  -----------------" << std::endl;
-    }
-
-    // Getter for a piece at a specific location
-    Piece* getPiece(int r, int c) const {
-        // Check bounds before accessing
-        if (r < 0 || r >= BOARD_SIZE || c < 0 || c >= BOARD_SIZE) {
-            return nullptr;
-        }
-        return grid[r][c];
-    }
-
-    // Moves a piece from (r1, c1) to (r2, c2)
-    void movePiece(int r1, int c1, int r2, int c2) {
-        Piece* piece = grid[r1][c1];
-        if (piece) {
-            // Update the grid
-            grid[r2][c2] = piece;
-            grid[r1][c1] = nullptr;
-            // Update the piece's internal position
-            piece->setPosition(r2, c2);
-        }
-    }
-
-    // Removes a captured piece (called after a jump)
-    void removePiece(int r, int c) {
-        Piece* capturedPiece = grid[r][c];
-        if (capturedPiece) {
-            delete capturedPiece; // Free the memory
-            grid[r][c] = nullptr; // Set the square to empty
-        }
-    }
-};
-
-// --- 4. GAME MANAGER CLASS ---
-
-/**
- * @class CheckersGame
- * @brief Manages the overall game flow, rules, and player turns.
- */
-class CheckersGame {
-private:
-    Board board;
-    Player currentPlayer;
-
-    // Struct to represent a potential move/jump
-    struct Move {
-        int startR, startC, endR, endC;
-    };
-
-    // Helper function to check if coordinates are within the board bounds
-    bool isInBounds(int r, int c) const {
-        return r >= 0 && r < BOARD_SIZE && c >= 0 && c < BOARD_SIZE;
-    }
-
-    // Checks if a specific move is a valid *simple* (non-jump) move
-    bool isSimpleMoveValid(int r1, int c1, int r2, int c2) const {
-        Piece* piece = board.getPiece(r1, c1);
-        if (!piece || board.getPiece(r2, c2)) {
-            return false; // No piece at start or target is occupied
-        }
-
-        // Must move exactly one diagonal square
-        if (std::abs(r2 - r1) != 1 || std::abs(c2 - c1) != 1) {
-            return false;
-        }
-
-        // Check direction for non-kings
-        if (!piece->isKing) {
-            if (piece->owner == RED && (r2 - r1) > 0) return false; // Red must move up (smaller row index)
-            if (piece->owner == BLACK && (r2 - r1) < 0) return false; // Black must move down (larger row index)
-        }
-
-        return true;
-    }
-
-    // Checks if a specific move is a valid *jump* (capture) move
-    // This is the core logic for capturing
-    bool isJumpValid(int r1, int c1, int r2, int c2) const {
-        Piece* piece = board.getPiece(r1, c1);
-        if (!piece || board.getPiece(r2, c2)) {
-            return false; // No piece at start or target is occupied
-        }
-
-        // Must move exactly two diagonal squares
-        if (std::abs(r2 - r1) != 2 || std::abs(c2 - c1) != 2) {
-            return false;
-        }
-
-        // Calculate the position of the jumped piece
-        int jumpedR = (r1 + r2) / 2;
-        int jumpedC = (c1 + c2) / 2;
-        Piece* jumpedPiece = board.getPiece(jumpedR, jumpedC);
-
-        // Check if there is an opponent's piece to jump over
-        if (!jumpedPiece || jumpedPiece->owner == piece->owner || jumpedPiece->owner == NONE) {
-            return false;
-        }
-
-        // Check direction for non-kings
-        if (!piece->isKing) {
-            if (piece->owner == RED && (r2 - r1) > 0) return false; // Red must move up (smaller row index)
-            if (piece->owner == BLACK && (r2 - r1) < 0) return false; // Black must move down (larger row index)
-        }
-
-        return true;
-    }
-
-    // Finds all possible jumps for a single piece
-    std::vector<Move> getPossibleJumpsForPiece(int r, int c) const {
-        std::vector<Move> jumps;
-        Piece* piece = board.getPiece(r, c);
-        if (!piece) return jumps;
-
-        // Possible jump directions: (-2, -2), (-2, +2), (+2, -2), (+2, +2)
-        int directions[4][2] = {{-2, -2}, {-2, 2}, {2, -2}, {2, 2}};
-
-        for (int i = 0; i < 4; ++i) {
-            int r2 = r + directions[i][0];
-            int c2 = c + directions[i][1];
-
-            if (isInBounds(r2, c2) && isJumpValid(r, c, r2, c2)) {
-                jumps.push_back({r, c, r2, c2});
-            }
-        }
-        return jumps;
-    }
-
-    // Finds ALL possible jumps for the current player on the board
-    std::vector<Move> getAllPossibleJumps() const {
-        std::vector<Move> allJumps;
-        for (int r = 0; r < BOARD_SIZE; ++r) {
-            for (int c = 0; c < BOARD_SIZE; ++c) {
-                Piece* piece = board.getPiece(r, c);
-                if (piece && piece->owner == currentPlayer) {
-                    std::vector<Move> jumps = getPossibleJumpsForPiece(r, c);
-                    allJumps.insert(allJumps.end(), jumps.begin(), jumps.end());
-                }
-            }
-        }
-        return allJumps;
-    }
-
-    // Finds all possible simple moves for the current player
-    std::vector<Move> getAllPossibleSimpleMoves() const {
-        std::vector<Move> allMoves;
-        for (int r = 0; r < BOARD_SIZE; ++r) {
-            for (int c = 0; c < BOARD_SIZE; ++c) {
-                Piece* piece = board.getPiece(r, c);
-                if (piece && piece->owner == currentPlayer) {
-                    // Check all 4 surrounding diagonal squares
-                    int directions[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
-                    for (int i = 0; i < 4; ++i) {
-                        int r2 = r + directions[i][0];
-                        int c2 = c + directions[i][1];
-
-                        if (isInBounds(r2, c2) && isSimpleMoveValid(r, c, r2, c2)) {
-                            allMoves.push_back({r, c, r2, c2});
-                        }
-                    }
-                }
-            }
-        }
-        return allMoves;
-    }
-
-    // Helper to switch the current player
-    void switchPlayer() {
-        currentPlayer = (currentPlayer == RED) ? BLACK : RED;
-    }
-
-    // Executes the actual move, including kinging and capture
-    bool executeMove(int r1, int c1, int r2, int c2) {
-        // 1. Perform the movement
-        board.movePiece(r1, c1, r2, c2);
-
-        // 2. Check for Capture (if it was a jump move)
-        if (std::abs(r2 - r1) == 2) {
-            int capturedR = (r1 + r2) / 2;
-            int capturedC = (c1 + c2) / 2;
-            board.removePiece(capturedR, capturedC);
-            std::cout << "-> PIECE CAPTURED at " << (char)('A' + capturedC) << capturedR + 1 << "!" << std::endl;
-
-            // 3. Check for multi-jump opportunity
-            if (!getPossibleJumpsForPiece(r2, c2).empty()) {
-                std::cout << "-> MULTI-JUMP AVAILABLE! Player " << (currentPlayer == RED ? "RED" : "BLACK")
-                          << " must continue jumping from " << (char)('A' + c2) << r2 + 1 << "." << std::endl;
-                // Force the same player to take another turn from the new position
-                return true;
-            }
-        }
-
-        // 4. Check for Kinging
-        Piece* piece = board.getPiece(r2, c2);
-        if (piece) {
-            if (piece->owner == RED && r2 == 0) { // Red reaches Black's back rank
-                piece->makeKing();
-                std::cout << "-> RED piece KINGED at " << (char)('A' + c2) << r2 + 1 << "!" << std::endl;
-            } else if (piece->owner == BLACK && r2 == BOARD_SIZE - 1) { // Black reaches Red's back rank
-                piece->makeKing();
-                std::cout << "-> BLACK piece KINGED at " << (char)('A' + c2) << r2 + 1 << "!" << std::endl;
-            }
-        }
-
-        // 5. Normal turn end
-        switchPlayer();
-        return false; // Turn is over
-    }
-
-    // Checks for win/loss condition (no more pieces or no more valid moves)
-    Player checkForWin() const {
-        int redPieces = 0;
-        int blackPieces = 0;
-        for (int i = 0; i < BOARD_SIZE; ++i) {
-            for (int j = 0; j < BOARD_SIZE; ++j) {
-                Piece* p = board.getPiece(i, j);
-                if (p) {
-                    if (p->owner == RED) redPieces++;
-                    if (p->owner == BLACK) blackPieces++;
-                }
-            }
-        }
-
-        if (redPieces == 0) return BLACK;
-        if (blackPieces == 0) return RED;
-
-        // Check if the current player has any possible moves (jumps or simple moves)
-        if (getAllPossibleJumps().empty() && getAllPossibleSimpleMoves().empty()) {
-             // If the current player has no moves, the other player wins
-             return (currentPlayer == RED) ? BLACK : RED;
-        }
-
-        return NONE; // No winner yet
-    }
-
-    // Parses user input like "A3 to B4" into coordinates (r1, c1, r2, c2)
-    bool parseInput(const std::string& input, int& r1, int& c1, int& r2, int& c2) {
-        // Expected format: XN to YM (e.g., A6 to B5)
-        if (input.length() < 7) return false;
-
-        // Convert column letters (A-H) to index (0-7)
-        c1 = std::toupper(input[0]) - 'A';
-        r1 = input[1] - '1'; // Convert row digit (1-8) to index (0-7)
-
-        // Expected " to " at index 2
-        if (input.substr(2, 4) != " to ") return false;
-
-        c2 = std::toupper(input[6]) - 'A';
-        r2 = input[7] - '1';
-
-        // Final coordinate checks
-        if (!isInBounds(r1, c1) || !isInBounds(r2, c2)) {
-            return false;
-        }
-
-        // Check that the move is actually a move and not staying in place
-        if (r1 == r2 && c1 == c2) {
-            return false;
-        }
-
-        return true;
-    }
-
-public:
-    CheckersGame() : currentPlayer(RED) {}
-
-    void run() {
-        board.initializeBoard();
-        std::cout << "===========================================" << std::endl;
-        std::cout << "      WELCOME TO C++ CONSOLE CHECKERS      " << std::endl;
-        std::cout << "===========================================" << std::endl;
-        std::cout << "Red (R) starts at the bottom. Black (B) at the top." << std::endl;
-        std::cout << "Input format: [COLROW] to [COLROW] (e.g., A6 to B5)" << std::endl;
-
-        while (true) {
-            board.displayBoard();
-
-            Player winner = checkForWin();
-            if (winner != NONE) {
-                std::cout << "\n*******************************************" << std::endl;
-                std::cout << "        PLAYER " << (winner == RED ? "RED" : "BLACK") << " WINS!         " << std::endl;
-                std::cout << "*******************************************" << std::endl;
-                break;
-            }
-
-            // Get available moves/jumps for the current player
-            std::vector<Move> forcedJumps = getAllPossibleJumps();
-            bool jumpIsForced = !forcedJumps.empty();
-
-            std::cout << "\n--- Player " << (currentPlayer == RED ? "RED (R/K)" : "BLACK (B/k)") << "'s Turn ---" << std::endl;
-            if (jumpIsForced) {
-                std::cout << "!!! JUMP IS MANDATORY !!! You must take a jump. !!!" << std::endl;
-            }
-
-            std::string input;
-            int r1, c1, r2, c2;
-            bool turnComplete = false;
-
-            // Loop until a valid move is made
-            while (!turnComplete) {
-                std::cout << "Enter move (e.g., A6 to B5) or 'exit': ";
-                std::getline(std::cin, input);
-
-                if (input == "exit" || input == "quit") {
-                    std::cout << "Game exited by player." << std::endl;
-                    return;
-                }
-
-                // Parse user input
-                if (!parseInput(input, r1, c1, r2, c2)) {
-                    std::cout << "Invalid input format or coordinates. Try again (e.g., A6 to B5)." << std::endl;
-                    continue;
-                }
-
-                // Get the piece to move
-                Piece* piece = board.getPiece(r1, c1);
-
-                // 1. Basic checks
-                if (!piece || piece->owner != currentPlayer) {
-                    std::cout << "Invalid selection. That square is empty or doesn't belong to you." << std::endl;
-                    continue;
-                }
-
-                bool isJump = std::abs(r2 - r1) == 2;
-                bool moveIsValid = false;
-                bool keepJumping = false; // For multi-jumps
-
-                // 2. Main Logic: Check if move is valid based on rules
-                if (jumpIsForced) {
-                    if (isJump) {
-                        if (isJumpValid(r1, c1, r2, c2)) {
-                            moveIsValid = true;
-                            keepJumping = executeMove(r1, c1, r2, c2);
-                            turnComplete = !keepJumping;
-                        } else {
-                            std::cout << "Invalid jump. You must capture an opponent's piece." << std::endl;
-                        }
-                    } else {
-                        std::cout << "A jump is available and MUST be taken. Please enter a valid jump move." << std::endl;
-                    }
-                } else {
-                    // No jump is forced, so check for simple move
-                    if (isJump) {
-                        if (isJumpValid(r1, c1, r2, c2)) {
-                            moveIsValid = true;
-                            keepJumping = executeMove(r1, c1, r2, c2);
-                            turnComplete = !keepJumping;
-                        } else {
-                             std::cout << "Invalid jump (no opponent piece to capture)." << std::endl;
-                        }
-                    } else if (isSimpleMoveValid(r1, c1, r2, c2)) {
-                        moveIsValid = true;
-                        executeMove(r1, c1, r2, c2);
-                        turnComplete = true; // Simple move always ends the turn
-                    } else {
-                        std::cout << "Invalid simple move. Check diagonal movement and direction rules." << std::endl;
-                    }
-                }
-            }
-        }
-    }
-};
-
-// --- 5. MAIN FUNCTION ---
-
-int main() {
-    // Set standard output to not synchronize with C standard streams for better performance
-    std::ios_base::sync_with_stdio(false);
-
-    // Create and run the game
-    CheckersGame game;
-    game.run();
-
-    return 0;
-}
\ No newline at end of file
+//
+// Created by BE129 on 11/19/2025.
+//
+
+
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits> // Required for input clearing
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <sstream>
+#include <fstream>
+#include <type_traits>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+// --- 1. ENUMS AND CONSTANTS ---
+
+// Define the two players
+enum Player {
+    NONE = 0,
+    RED = 1,  // Starts at the bottom of the board (Rows 5, 6, 7)
+    BLACK = 2 // Starts at the top of the board (Rows 0, 1, 2)
+};
+
+// Define the possible states of a square on the board
+enum SquareType {
+    EMPTY,
+    RED_PIECE,
+    BLACK_PIECE,
+    RED_KING,
+    BLACK_KING
+};
+
+const int BOARD_SIZE = 8;
+const char PIECE_SYMBOLS[] = {' ', 'R', 'B', 'K', 'k'}; // Corresponding symbols for display
+
+// --- 2. PIECE CLASS ---
+
+/**
+ * @class Piece
+ * @brief Represents a single checker on the board.
+ */
+class Piece {
+public:
+    Player owner;
+    bool isKing;
+    int row;
+    int col;
+
+    Piece(Player p, int r, int c) : owner(p), isKing(false), row(r), col(c) {}
+
+    // Default constructor for placeholder, should generally not be used
+    Piece() : owner(NONE), isKing(false), row(-1), col(-1) {}
+
+    // Convert the piece state to a displayable symbol
+    char getSymbol() const {
+        if (owner == NONE) return ' ';
+        if (isKing) {
+            return (owner == RED) ? PIECE_SYMBOLS[RED_KING] : PIECE_SYMBOLS[BLACK_KING];
+        } else {
+            return (owner == RED) ? PIECE_SYMBOLS[RED_PIECE] : PIECE_SYMBOLS[BLACK_PIECE];
+        }
+    }
+
+    // Promote the piece to a King
+    void makeKing() {
+        isKing = true;
+    }
+
+    // Update the piece's position
+    void setPosition(int r, int c) {
+        row = r;
+        col = c;
+    }
+};
+
+// --- 3. BOARD CLASS ---
+
+/**
+ * @class Board
+ * @brief Manages the 8x8 game grid and piece placement.
+ */
+class Board {
+private:
+    // One step made with makeMove(), as needed to take it back
+    struct UndoRecord {
+        uint8_t fromR, fromC, toR, toC;
+        bool crowned;    // The moving piece was kinged at the end of this step
+        Piece* captured; // Jumped piece, kept in the pool off the board until the step is undone
+    };
+
+    // A standard game needs 24 pieces; one slot per dark square also covers any set-up
+    static const int PIECE_POOL_SIZE = 32;
+
+    // 8x8 grid holding pointers to Piece objects
+    Piece* grid[BOARD_SIZE][BOARD_SIZE];
+    int pieceCounts[3]; // Pieces on the board, indexed by Player
+    std::vector<UndoRecord> undoStack;
+
+    // Every Piece lives in this per-board pool instead of on the heap. Slots are handed
+    // out in order and released slots are reused; reset() reclaims them all at once.
+    Piece piecePool[PIECE_POOL_SIZE];
+    Piece* freePieces[PIECE_POOL_SIZE];
+    int poolUsed;  // Slots handed out so far
+    int freeCount; // Released slots waiting for reuse
+
+    Piece* allocatePiece(Player owner, int r, int c) {
+        Piece* piece = freeCount > 0 ? freePieces[--freeCount] : &piecePool[poolUsed++];
+        *piece = Piece(owner, r, c);
+        return piece;
+    }
+
+    void releasePiece(Piece* piece) {
+        freePieces[freeCount++] = piece;
+    }
+
+    // Empties the grid and reclaims every piece, including those held by the undo stack
+    void reset() {
+        std::memset(grid, 0, sizeof(grid));
+        pieceCounts[NONE] = pieceCounts[RED] = pieceCounts[BLACK] = 0;
+        poolUsed = 0;
+        freeCount = 0;
+        undoStack.clear();
+    }
+
+public:
+    Board() {
+        // Initialize the grid to be all empty pointers (nullptr)
+        reset();
+        undoStack.reserve(256);
+    }
+
+    // Pieces point into this board's own pool, so boards are not copyable
+    Board(const Board&) = delete;
+    Board& operator=(const Board&) = delete;
+
+    // Removes every piece from the board and forgets the move history
+    void clearBoard() {
+        reset();
+    }
+
+    // Puts a new piece on an empty square (used to set up arbitrary positions)
+    void placePiece(int r, int c, Player owner, bool isKing) {
+        if (grid[r][c]) {
+            --pieceCounts[grid[r][c]->owner];
+            releasePiece(grid[r][c]);
+        }
+        grid[r][c] = allocatePiece(owner, r, c);
+        if (isKing) grid[r][c]->makeKing();
+        ++pieceCounts[owner];
+    }
+
+    // Sets up the board with 12 pieces for each player
+    void initializeBoard() {
+        // Clear any existing pieces
+        clearBoard();
+
+        // BLACK pieces (start at top, rows 0, 1, 2)
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < BOARD_SIZE; ++c) {
+                // Pieces are only placed on "dark" squares (row + col is odd)
+                if ((r + c) % 2 != 0) {
+                    grid[r][c] = allocatePiece(BLACK, r, c);
+                    ++pieceCounts[BLACK];
+                }
+            }
+        }
+
+        // RED pieces (start at bottom, rows 5, 6, 7)
+        for (int r = 5; r < BOARD_SIZE; ++r) {
+            for (int c = 0; c < BOARD_SIZE; ++c) {
+                if ((r + c) % 2 != 0) {
+                    grid[r][c] = allocatePiece(RED, r, c);
+                    ++pieceCounts[RED];
+                }
+            }
+        }
+    }
+
+    // Prints the current state of the board to the console. The board is rendered into one
+    // buffer and handed to the stream with a single flush; with cursorHome it is redrawn in
+    // place at the top of the terminal (ANSI) instead of scrolling.
+    void displayBoard(bool cursorHome = false) const {
+        static const char HOME[] = "\x1b[H\x1b[J";
+        static const char HEADER[] = "\n    A B C D E F G H (Columns)\n  -----------------\n";
+        static const char RULE[] = "  -----------------\n";
+        char buffer[512];
+        size_t length = 0;
+        if (cursorHome) {
+            std::memcpy(buffer, HOME, sizeof(HOME) - 1);
+            length += sizeof(HOME) - 1;
+        }
+        std::memcpy(buffer + length, HEADER, sizeof(HEADER) - 1);
+        length += sizeof(HEADER) - 1;
+        for (int i = 0; i < BOARD_SIZE; ++i) {
+            buffer[length++] = (char)('1' + i); // Row number (1-8)
+            buffer[length++] = ' ';
+            buffer[length++] = '|';
+            for (int j = 0; j < BOARD_SIZE; ++j) {
+                buffer[length++] = ' ';
+                if (grid[i][j]) {
+                    buffer[length++] = grid[i][j]->getSymbol();
+                } else {
+                    // Only show a marker for playable (dark) squares
+                    buffer[length++] = ((i + j) % 2 != 0) ? '.' : ' ';
+                }
+            }
+            buffer[length++] = ' ';
+            buffer[length++] = '|';
+            buffer[length++] = '\n';
+        }
+        std::memcpy(buffer + length, RULE, sizeof(RULE) - 1);
+        length += sizeof(RULE) - 1;
+        std::cout.write(buffer, length);
+        std::cout.flush();
+    }
+
+    // Getter for a piece at a specific location
+    Piece* getPiece(int r, int c) const {
+        // Check bounds before accessing
+        if (r < 0 || r >= BOARD_SIZE || c < 0 || c >= BOARD_SIZE) {
+            return nullptr;
+        }
+        return grid[r][c];
+    }
+
+    // Number of pieces a player has on the board, kept up to date by every change
+    int pieceCount(Player player) const {
+        return pieceCounts[player];
+    }
+
+    // Moves a piece from (r1, c1) to (r2, c2)
+    void movePiece(int r1, int c1, int r2, int c2) {
+        Piece* piece = grid[r1][c1];
+        if (piece) {
+            // Update the grid
+            grid[r2][c2] = piece;
+            grid[r1][c1] = nullptr;
+            // Update the piece's internal position
+            piece->setPosition(r2, c2);
+        }
+    }
+
+    // Removes a captured piece (called after a jump)
+    void removePiece(int r, int c) {
+        Piece* capturedPiece = grid[r][c];
+        if (capturedPiece) {
+            --pieceCounts[capturedPiece->owner];
+            releasePiece(capturedPiece); // Return the slot to the pool
+            grid[r][c] = nullptr; // Set the square to empty
+        }
+    }
+
+    // Moves a piece one step and, for a jump, lifts the jumped piece off the board.
+    // Nothing is freed, so unmakeMove() can put everything back without allocating.
+    void makeMove(int r1, int c1, int r2, int c2) {
+        UndoRecord record = {(uint8_t)r1, (uint8_t)c1, (uint8_t)r2, (uint8_t)c2, false, nullptr};
+        if (std::abs(r2 - r1) == 2) {
+            int capturedR = (r1 + r2) / 2;
+            int capturedC = (c1 + c2) / 2;
+            record.captured = grid[capturedR][capturedC];
+            grid[capturedR][capturedC] = nullptr;
+            if (record.captured) --pieceCounts[record.captured->owner];
+        }
+        movePiece(r1, c1, r2, c2);
+        undoStack.push_back(record);
+    }
+
+    // Kings the piece that made the last step and remembers it for unmakeMove()
+    void crownLastMoved() {
+        UndoRecord& record = undoStack.back();
+        grid[record.toR][record.toC]->makeKing();
+        record.crowned = true;
+    }
+
+    // Takes back the last step made with makeMove()
+    void unmakeMove() {
+        UndoRecord record = undoStack.back();
+        undoStack.pop_back();
+        if (record.crowned) grid[record.toR][record.toC]->isKing = false;
+        movePiece(record.toR, record.toC, record.fromR, record.fromC);
+        if (record.captured) {
+            int capturedR = (record.fromR + record.toR) / 2;
+            int capturedC = (record.fromC + record.toC) / 2;
+            grid[capturedR][capturedC] = record.captured;
+            ++pieceCounts[record.captured->owner];
+        }
+    }
+
+    // Number of steps that unmakeMove() can take back
+    size_t historySize() const {
+        return undoStack.size();
+    }
+};
+
+// --- 4. COMPACT POSITION AND MOVE GENERATION ---
+
+// The 32 playable (dark) squares are numbered row by row: square = row * 4 + col / 2.
+// Adding one gives the standard 1-32 checkers square numbers.
+const int NUM_SQUARES = 32;
+const int MAX_MOVES = 128;     // Upper bound on legal moves in any position
+const int MAX_JUMP_PATH = 12;  // A single turn can capture at most 12 pieces
+
+const uint32_t RED_CROWN_ROW = 0x0000000Fu;   // Row 0, where RED men are kinged
+const uint32_t BLACK_CROWN_ROW = 0xF0000000u; // Row 7, where BLACK men are kinged
+
+inline int squareRow(int sq) {
+    return sq / 4;
+}
+
+inline int squareCol(int sq) {
+    // Dark squares sit on odd columns in even rows and even columns in odd rows
+    return (sq % 4) * 2 + ((sq / 4) % 2 == 0 ? 1 : 0);
+}
+
+inline int squareAt(int r, int c) {
+    return r * 4 + c / 2;
+}
+
+inline Player opponentOf(Player p) {
+    return (p == RED) ? BLACK : RED;
+}
+
+inline int popCount(uint32_t bits) {
+#if defined(__GNUC__)
+    return __builtin_popcount(bits);
+#else
+    int count = 0;
+    while (bits) { bits &= bits - 1; ++count; }
+    return count;
+#endif
+}
+
+inline int lowestSquare(uint32_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctz(bits);
+#else
+    int sq = 0;
+    while (!(bits & 1u)) { bits >>= 1; ++sq; }
+    return sq;
+#endif
+}
+
+/**
+ * @struct SquareTables
+ * @brief Precomputed diagonal neighbours of every dark square.
+ *
+ * Directions use the same order as the move generators in CheckersGame:
+ * 0 = (-1, -1), 1 = (-1, +1), 2 = (+1, -1), 3 = (+1, +1). Off-board entries are -1.
+ */
+struct SquareTables {
+    int8_t step[NUM_SQUARES][4]; // Adjacent square (or the piece jumped over)
+    int8_t jump[NUM_SQUARES][4]; // Landing square of a jump
+
+    SquareTables() {
+        const int directions[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+        for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+            for (int d = 0; d < 4; ++d) {
+                int r1 = squareRow(sq) + directions[d][0];
+                int c1 = squareCol(sq) + directions[d][1];
+                int r2 = squareRow(sq) + 2 * directions[d][0];
+                int c2 = squareCol(sq) + 2 * directions[d][1];
+                bool stepOk = r1 >= 0 && r1 < BOARD_SIZE && c1 >= 0 && c1 < BOARD_SIZE;
+                bool jumpOk = r2 >= 0 && r2 < BOARD_SIZE && c2 >= 0 && c2 < BOARD_SIZE;
+                step[sq][d] = stepOk ? (int8_t)squareAt(r1, c1) : (int8_t)-1;
+                jump[sq][d] = jumpOk ? (int8_t)squareAt(r2, c2) : (int8_t)-1;
+            }
+        }
+    }
+};
+
+const SquareTables SQUARE_TABLES;
+
+// Men may only move "forward": RED towards row 0, BLACK towards row 7
+inline bool isForward(Player p, int direction) {
+    return (p == RED) ? direction < 2 : direction >= 2;
+}
+
+/**
+ * @struct Position
+ * @brief Compact value-type snapshot of a position: one bit per dark square.
+ */
+struct Position {
+    uint32_t red;
+    uint32_t black;
+    uint32_t kings;
+    Player sideToMove;
+
+    uint32_t occupied() const { return red | black; }
+    uint32_t own() const { return (sideToMove == RED) ? red : black; }
+    uint32_t enemies() const { return (sideToMove == RED) ? black : red; }
+
+    bool operator==(const Position& other) const {
+        return red == other.red && black == other.black && kings == other.kings && sideToMove == other.sideToMove;
+    }
+};
+
+/**
+ * @struct FullMove
+ * @brief A complete turn: a simple move or a whole (multi-)jump sequence.
+ */
+struct FullMove {
+    uint8_t from;
+    uint8_t to;
+    uint8_t pathLength;          // Number of landing squares (1 for a simple move)
+    uint8_t path[MAX_JUMP_PATH]; // Landing squares in the order they are visited
+    uint32_t captures;           // Bitmask of captured squares
+
+    bool isCapture() const { return captures != 0; }
+};
+
+/**
+ * @struct MoveList
+ * @brief Fixed-capacity move list so move generation never touches the heap.
+ */
+struct MoveList {
+    FullMove moves[MAX_MOVES];
+    int count;
+
+    MoveList() : count(0) {}
+
+    void add(const FullMove& move) {
+        if (count < MAX_MOVES) moves[count++] = move;
+    }
+};
+
+// Takes a snapshot of the interactive board
+Position positionFromBoard(const Board& board, Player sideToMove) {
+    Position pos = {0, 0, 0, sideToMove};
+    for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+        Piece* p = board.getPiece(squareRow(sq), squareCol(sq));
+        if (!p) continue;
+        uint32_t bit = 1u << sq;
+        if (p->owner == RED) pos.red |= bit;
+        if (p->owner == BLACK) pos.black |= bit;
+        if (p->isKing) pos.kings |= bit;
+    }
+    return pos;
+}
+
+// Replaces the interactive board's contents with a compact position
+void setupBoard(Board& board, const Position& pos) {
+    board.clearBoard();
+    for (uint32_t bits = pos.occupied(); bits; bits &= bits - 1) {
+        int sq = lowestSquare(bits);
+        Player owner = ((pos.red >> sq) & 1u) ? RED : BLACK;
+        board.placePiece(squareRow(sq), squareCol(sq), owner, ((pos.kings >> sq) & 1u) != 0);
+    }
+}
+
+// Plays a whole move step by step with Board::makeMove(), kinging a man that ends on the
+// crown row; undo it with one Board::unmakeMove() per step
+void makeBoardMove(Board& board, const FullMove& move) {
+    int from = move.from;
+    for (int i = 0; i < move.pathLength; ++i) {
+        board.makeMove(squareRow(from), squareCol(from), squareRow(move.path[i]), squareCol(move.path[i]));
+        from = move.path[i];
+    }
+    const Piece* piece = board.getPiece(squareRow(from), squareCol(from));
+    int crownRow = (piece->owner == RED) ? 0 : BOARD_SIZE - 1;
+    if (!piece->isKing && squareRow(from) == crownRow) board.crownLastMoved();
+}
+
+// Recursively extends a jump sequence from 'sq'. Captured pieces leave the board
+// immediately and a man that reaches the crown row stops, exactly as in executeMove().
+void extendJumps(Player side, bool isKing, uint32_t enemies, uint32_t occupied, int sq,
+                 FullMove& current, MoveList& list) {
+    bool extended = false;
+    for (int d = 0; d < 4; ++d) {
+        if (!isKing && !isForward(side, d)) continue;
+        int over = SQUARE_TABLES.step[sq][d];
+        int land = SQUARE_TABLES.jump[sq][d];
+        if (land < 0) continue;
+        uint32_t overBit = 1u << over;
+        if (!(enemies & overBit) || (occupied & (1u << land))) continue;
+
+        current.path[current.pathLength++] = (uint8_t)land;
+        current.captures |= overBit;
+        extendJumps(side, isKing, enemies & ~overBit, occupied & ~overBit, land, current, list);
+        current.captures &= ~overBit;
+        current.pathLength--;
+        extended = true;
+    }
+
+    if (!extended && current.pathLength > 0) {
+        current.to = (uint8_t)sq;
+        list.add(current);
+    }
+}
+
+// Generates every legal turn for the side to move. Jumps are mandatory, so simple
+// moves are only produced when no jump exists (the same rule run() enforces).
+int generateMoves(const Position& pos, MoveList& list) {
+    list.count = 0;
+    Player side = pos.sideToMove;
+    uint32_t own = pos.own();
+    uint32_t enemies = pos.enemies();
+    uint32_t occupied = pos.occupied();
+
+    for (uint32_t bits = own; bits; bits &= bits - 1) {
+        int sq = lowestSquare(bits);
+        FullMove move;
+        move.from = (uint8_t)sq;
+        move.to = (uint8_t)sq;
+        move.pathLength = 0;
+        move.captures = 0;
+        // The moving piece is lifted off the board for the whole sequence
+        extendJumps(side, (pos.kings >> sq) & 1u, enemies, occupied & ~(1u << sq), sq, move, list);
+    }
+    if (list.count > 0) return list.count;
+
+    for (uint32_t bits = own; bits; bits &= bits - 1) {
+        int sq = lowestSquare(bits);
+        bool isKing = (pos.kings >> sq) & 1u;
+        for (int d = 0; d < 4; ++d) {
+            if (!isKing && !isForward(side, d)) continue;
+            int target = SQUARE_TABLES.step[sq][d];
+            if (target < 0 || (occupied & (1u << target))) continue;
+            FullMove move;
+            move.from = (uint8_t)sq;
+            move.to = (uint8_t)target;
+            move.pathLength = 1;
+            move.path[0] = (uint8_t)target;
+            move.captures = 0;
+            list.add(move);
+        }
+    }
+    return list.count;
+}
+
+// Returns the position after 'move' has been played (copy-make)
+Position applyMove(const Position& pos, const FullMove& move) {
+    Position next = pos;
+    uint32_t fromBit = 1u << move.from;
+    uint32_t toBit = 1u << move.to;
+    bool wasKing = (pos.kings & fromBit) != 0;
+
+    if (pos.sideToMove == RED) {
+        next.red = (next.red & ~fromBit) | toBit;
+        next.black &= ~move.captures;
+    } else {
+        next.black = (next.black & ~fromBit) | toBit;
+        next.red &= ~move.captures;
+    }
+
+    next.kings &= ~(fromBit | move.captures);
+    uint32_t crownRow = (pos.sideToMove == RED) ? RED_CROWN_ROW : BLACK_CROWN_ROW;
+    if (wasKing || (toBit & crownRow)) {
+        next.kings |= toBit;
+    }
+
+    next.sideToMove = opponentOf(pos.sideToMove);
+    return next;
+}
+
+// Contents of a SquareBoard square: the owner (a Player) in the low two bits plus a king
+// flag. The off-board sentinel is neither empty nor anybody's piece, so stepping or
+// jumping onto it fails without any bounds check.
+const uint8_t SQUARE_EMPTY = 0;
+const uint8_t SQUARE_KING = 4;
+const uint8_t SQUARE_OFF_BOARD = 8;
+const int OFF_BOARD = NUM_SQUARES; // Index of the sentinel square
+
+/**
+ * @struct PaddedTables
+ * @brief SQUARE_TABLES with every off-board neighbour pointing at the sentinel square.
+ */
+struct PaddedTables {
+    uint8_t step[NUM_SQUARES][4];
+    uint8_t jump[NUM_SQUARES][4];
+
+    PaddedTables() {
+        for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+            for (int d = 0; d < 4; ++d) {
+                step[sq][d] = (uint8_t)(SQUARE_TABLES.step[sq][d] < 0 ? OFF_BOARD : SQUARE_TABLES.step[sq][d]);
+                jump[sq][d] = (uint8_t)(SQUARE_TABLES.jump[sq][d] < 0 ? OFF_BOARD : SQUARE_TABLES.jump[sq][d]);
+            }
+        }
+    }
+};
+
+const PaddedTables PADDED_TABLES;
+
+/**
+ * @struct SquareBoard
+ * @brief Data-oriented board backend: one byte per dark square plus a sentinel.
+ *
+ * Only the 32 playable squares are stored, so move generation never visits light
+ * squares or checks bounds. The whole board is one cache line and trivially copyable,
+ * which makes copy-make as cheap as for Position.
+ */
+struct alignas(64) SquareBoard {
+    uint8_t squares[NUM_SQUARES + 1]; // [OFF_BOARD] always holds SQUARE_OFF_BOARD
+    uint8_t sideToMove;               // A Player
+    uint8_t pieceCounts[3];           // Pieces on the board, indexed by Player
+
+    void clear() {
+        std::memset(squares, SQUARE_EMPTY, NUM_SQUARES);
+        squares[OFF_BOARD] = SQUARE_OFF_BOARD;
+        sideToMove = RED;
+        pieceCounts[NONE] = pieceCounts[RED] = pieceCounts[BLACK] = 0;
+    }
+
+    void place(int sq, Player owner, bool isKing) {
+        squares[sq] = (uint8_t)(owner | (isKing ? SQUARE_KING : 0));
+        ++pieceCounts[owner];
+    }
+
+    static SquareBoard fromPosition(const Position& pos) {
+        SquareBoard board;
+        board.clear();
+        for (uint32_t bits = pos.occupied(); bits; bits &= bits - 1) {
+            int sq = lowestSquare(bits);
+            board.place(sq, ((pos.red >> sq) & 1u) ? RED : BLACK, ((pos.kings >> sq) & 1u) != 0);
+        }
+        board.sideToMove = (uint8_t)pos.sideToMove;
+        return board;
+    }
+
+    Position toPosition() const {
+        Position pos = {0, 0, 0, (Player)sideToMove};
+        for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+            uint32_t bit = 1u << sq;
+            if ((squares[sq] & 3) == RED) pos.red |= bit;
+            if ((squares[sq] & 3) == BLACK) pos.black |= bit;
+            if (squares[sq] & SQUARE_KING) pos.kings |= bit;
+        }
+        return pos;
+    }
+
+    // Same rules and move order as generateMoves(const Position&, MoveList&)
+    int generateMoves(MoveList& list) const {
+        list.count = 0;
+        Player side = (Player)sideToMove;
+        SquareBoard scratch = *this; // Jump search lifts pieces off a private copy
+        for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+            uint8_t piece = squares[sq];
+            if ((piece & 3) != side) continue;
+            FullMove move;
+            move.from = (uint8_t)sq;
+            move.to = (uint8_t)sq;
+            move.pathLength = 0;
+            move.captures = 0;
+            scratch.squares[sq] = SQUARE_EMPTY;
+            scratch.extendJumps(piece, sq, move, list);
+            scratch.squares[sq] = piece;
+        }
+        if (list.count > 0) return list.count;
+
+        for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+            uint8_t piece = squares[sq];
+            if ((piece & 3) != side) continue;
+            for (int d = 0; d < 4; ++d) {
+                if (!(piece & SQUARE_KING) && !isForward(side, d)) continue;
+                int target = PADDED_TABLES.step[sq][d];
+                if (squares[target] != SQUARE_EMPTY) continue;
+                FullMove move;
+                move.from = (uint8_t)sq;
+                move.to = (uint8_t)target;
+                move.pathLength = 1;
+                move.path[0] = (uint8_t)target;
+                move.captures = 0;
+                list.add(move);
+            }
+        }
+        return list.count;
+    }
+
+    // Plays a move in place; copy the board first to keep the old position
+    void makeMove(const FullMove& move) {
+        uint8_t piece = squares[move.from];
+        Player side = (Player)(piece & 3);
+        squares[move.from] = SQUARE_EMPTY;
+        for (uint32_t bits = move.captures; bits; bits &= bits - 1) {
+            squares[lowestSquare(bits)] = SQUARE_EMPTY;
+            --pieceCounts[opponentOf(side)];
+        }
+        int crownRow = (side == RED) ? 0 : BOARD_SIZE - 1;
+        if (squareRow(move.to) == crownRow) piece |= SQUARE_KING;
+        squares[move.to] = piece;
+        sideToMove = (uint8_t)opponentOf(side);
+    }
+
+private:
+    void extendJumps(uint8_t piece, int sq, FullMove& current, MoveList& list) {
+        Player side = (Player)(piece & 3);
+        Player enemy = opponentOf(side);
+        bool extended = false;
+        for (int d = 0; d < 4; ++d) {
+            if (!(piece & SQUARE_KING) && !isForward(side, d)) continue;
+            int over = PADDED_TABLES.step[sq][d];
+            int land = PADDED_TABLES.jump[sq][d];
+            if ((squares[over] & 3) != enemy || squares[land] != SQUARE_EMPTY) continue;
+
+            uint8_t captured = squares[over];
+            squares[over] = SQUARE_EMPTY;
+            current.path[current.pathLength++] = (uint8_t)land;
+            current.captures |= 1u << over;
+            extendJumps(piece, land, current, list);
+            current.captures &= ~(1u << over);
+            current.pathLength--;
+            squares[over] = captured;
+            extended = true;
+        }
+
+        if (!extended && current.pathLength > 0) {
+            current.to = (uint8_t)sq;
+            list.add(current);
+        }
+    }
+};
+
+static_assert(sizeof(SquareBoard) == 64, "SquareBoard should fill exactly one cache line");
+static_assert(std::is_trivially_copyable<SquareBoard>::value, "SquareBoard is copied during search");
+
+// --- 5. MEMORY-MAPPED FILES ---
+
+/**
+ * @class MappedFile
+ * @brief Read-only view of a whole file. Uses mmap() so opening costs nothing
+ * regardless of file size; on Windows the file is simply read into memory.
+ */
+class MappedFile {
+private:
+    const unsigned char* bytes;
+    size_t length;
+#if defined(_WIN32)
+    std::vector<unsigned char> buffer;
+#endif
+
+    MappedFile(const MappedFile&);            // Non-copyable
+    MappedFile& operator=(const MappedFile&);
+
+public:
+    MappedFile() : bytes(nullptr), length(0) {}
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        close();
+#if defined(_WIN32)
+        std::ifstream in(path.c_str(), std::ios::binary);
+        if (!in) return false;
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        bytes = buffer.data();
+        length = buffer.size();
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        length = (size_t)info.st_size;
+        if (length > 0) {
+            void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            bytes = (const unsigned char*)mapped;
+        }
+        ::close(fd); // The mapping stays valid after the descriptor is closed
+        return true;
+#endif
+    }
+
+    void close() {
+#if defined(_WIN32)
+        buffer.clear();
+#else
+        if (bytes) munmap((void*)bytes, length);
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != nullptr; }
+};
+
+// --- 6. ENDGAME TABLEBASES ---
+
+// Two-bit results, always from the point of view of the side to move
+enum TablebaseResult {
+    TB_DRAW = 0,
+    TB_WIN = 1,
+    TB_LOSS = 2,
+    TB_UNKNOWN = 3 // Only used while a slice is being solved
+};
+
+const int TB_MAX_PIECES = 8;
+const uint32_t TB_BLOCK_POSITIONS = 16384; // Positions per compressed block (4 KB unpacked)
+const int TB_CACHE_SHARDS = 16;            // Independently locked parts of the block cache
+const int TB_CACHE_BLOCKS = 8;             // Decompressed blocks kept by each shard's LRU
+const char TB_MAGIC[8] = {'C', 'K', 'T', 'B', 'L', 'B', '0', '1'};
+
+// On-disk layout: header, slice directory, per-slice block offset tables, block data
+struct TablebaseFileHeader {
+    char magic[8];
+    uint32_t maxPieces;
+    uint32_t sliceCount;
+    uint32_t blockPositions;
+    uint32_t reserved;
+};
+
+struct TablebaseSliceRecord {
+    uint32_t key;              // Packed SliceKey
+    uint32_t blockCount;
+    uint64_t positionCount;
+    uint64_t blockTableOffset; // File offset of blockCount + 1 uint64 block offsets
+};
+
+/**
+ * @struct BinomialTable
+ * @brief Binomial coefficients used to rank piece placements.
+ */
+struct BinomialTable {
+    uint64_t value[NUM_SQUARES + 1][TB_MAX_PIECES + 1];
+
+    BinomialTable() {
+        for (int n = 0; n <= NUM_SQUARES; ++n) {
+            for (int k = 0; k <= TB_MAX_PIECES; ++k) {
+                if (k == 0) value[n][k] = 1;
+                else if (n == 0) value[n][k] = 0;
+                else value[n][k] = value[n - 1][k - 1] + value[n - 1][k];
+            }
+        }
+    }
+};
+
+const BinomialTable BINOMIALS;
+
+/**
+ * @struct SliceKey
+ * @brief Material signature of a tablebase slice (men and kings per side).
+ */
+struct SliceKey {
+    int redMen;
+    int redKings;
+    int blackMen;
+    int blackKings;
+
+    uint32_t packed() const {
+        return (uint32_t)(redMen | (redKings << 4) | (blackMen << 8) | (blackKings << 12));
+    }
+
+    int pieces() const { return redMen + redKings + blackMen + blackKings; }
+    int men() const { return redMen + blackMen; }
+
+    // Men can never stand on their own crown row, so they range over 28 squares
+    uint64_t positionCount() const {
+        return BINOMIALS.value[28][redMen] * BINOMIALS.value[28][blackMen] *
+               BINOMIALS.value[32][redKings] * BINOMIALS.value[32][blackKings] * 2;
+    }
+};
+
+SliceKey sliceKeyOf(const Position& pos) {
+    SliceKey key;
+    key.redMen = popCount(pos.red & ~pos.kings);
+    key.redKings = popCount(pos.red & pos.kings);
+    key.blackMen = popCount(pos.black & ~pos.kings);
+    key.blackKings = popCount(pos.black & pos.kings);
+    return key;
+}
+
+// Colexicographic rank of a set of squares, each shifted down by 'offset'
+uint64_t rankSquares(uint32_t bits, int offset) {
+    uint64_t rank = 0;
+    int i = 1;
+    for (; bits; bits &= bits - 1, ++i) {
+        rank += BINOMIALS.value[lowestSquare(bits) - offset][i];
+    }
+    return rank;
+}
+
+uint32_t unrankSquares(uint64_t rank, int count, int range, int offset) {
+    uint32_t bits = 0;
+    int candidate = range - 1;
+    for (int i = count; i >= 1; --i) {
+        while (BINOMIALS.value[candidate][i] > rank) --candidate;
+        rank -= BINOMIALS.value[candidate][i];
+        bits |= 1u << (candidate + offset);
+        --candidate;
+    }
+    return bits;
+}
+
+// RED men live on squares 4-31 and BLACK men on squares 0-27
+uint64_t tablebaseIndex(const Position& pos, const SliceKey& key) {
+    uint64_t index = rankSquares(pos.red & ~pos.kings, 4);
+    index = index * BINOMIALS.value[28][key.blackMen] + rankSquares(pos.black & ~pos.kings, 0);
+    index = index * BINOMIALS.value[32][key.redKings] + rankSquares(pos.red & pos.kings, 0);
+    index = index * BINOMIALS.value[32][key.blackKings] + rankSquares(pos.black & pos.kings, 0);
+    return index * 2 + (pos.sideToMove == BLACK ? 1 : 0);
+}
+
+// Decodes an index; returns false for the unused indices where pieces overlap
+bool positionFromIndex(const SliceKey& key, uint64_t index, Position& pos) {
+    pos.sideToMove = (index & 1) ? BLACK : RED;
+    index >>= 1;
+    uint64_t bkCount = BINOMIALS.value[32][key.blackKings];
+    uint64_t rkCount = BINOMIALS.value[32][key.redKings];
+    uint64_t bmCount = BINOMIALS.value[28][key.blackMen];
+    uint32_t blackKings = unrankSquares(index % bkCount, key.blackKings, 32, 0);
+    index /= bkCount;
+    uint32_t redKings = unrankSquares(index % rkCount, key.redKings, 32, 0);
+    index /= rkCount;
+    uint32_t blackMen = unrankSquares(index % bmCount, key.blackMen, 28, 0);
+    index /= bmCount;
+    uint32_t redMen = unrankSquares(index, key.redMen, 28, 4);
+
+    if ((redMen & blackMen) || ((redMen | blackMen) & (redKings | blackKings)) || (redKings & blackKings)) {
+        return false;
+    }
+    pos.red = redMen | redKings;
+    pos.black = blackMen | blackKings;
+    pos.kings = redKings | blackKings;
+    return true;
+}
+
+inline int getPackedResult(const uint8_t* data, uint64_t index) {
+    return (data[index >> 2] >> ((index & 3) * 2)) & 3;
+}
+
+inline void setPackedResult(uint8_t* data, uint64_t index, int value) {
+    int shift = (int)(index & 3) * 2;
+    data[index >> 2] = (uint8_t)((data[index >> 2] & ~(3 << shift)) | (value << shift));
+}
+
+// PackBits run-length coding: a control byte n < 128 is followed by n + 1 literal
+// bytes, a control byte n >= 128 repeats the next byte n - 126 times.
+void compressBlock(const uint8_t* in, size_t size, std::vector<uint8_t>& out) {
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && run < 129 && in[i + run] == in[i]) ++run;
+        if (run >= 2) {
+            out.push_back((uint8_t)(run + 126));
+            out.push_back(in[i]);
+            i += run;
+            continue;
+        }
+        size_t start = i;
+        size_t literals = 0;
+        while (i < size && literals < 128 && !(i + 1 < size && in[i + 1] == in[i])) {
+            ++i;
+            ++literals;
+        }
+        if (literals == 0) { // Lone byte in front of a run
+            ++i;
+            literals = 1;
+        }
+        out.push_back((uint8_t)(literals - 1));
+        out.insert(out.end(), in + start, in + start + literals);
+    }
+}
+
+bool decompressBlock(const uint8_t* in, size_t inSize, uint8_t* out, size_t outSize) {
+    size_t i = 0;
+    size_t o = 0;
+    while (i < inSize && o < outSize) {
+        int control = in[i++];
+        if (control < 128) {
+            size_t count = (size_t)control + 1;
+            if (i + count > inSize || o + count > outSize) return false;
+            std::memcpy(out + o, in + i, count);
+            i += count;
+            o += count;
+        } else {
+            size_t count = (size_t)control - 126;
+            if (i >= inSize || o + count > outSize) return false;
+            std::memset(out + o, in[i++], count);
+            o += count;
+        }
+    }
+    return o == outSize;
+}
+
+// Peak resident set size of this process in megabytes (0 where unsupported)
+double peakResidentMegabytes() {
+#if defined(_WIN32)
+    return 0.0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+    return usage.ru_maxrss / 1024.0; // ru_maxrss is reported in kilobytes on Linux
+#endif
+}
+
+/**
+ * @class TablebaseGenerator
+ * @brief Builds win/loss/draw databases for every material slice up to a piece limit.
+ *
+ * Slices are solved in waves of equal piece count and number of men. Captures and
+ * promotions always lead into an earlier wave, so the slices of one wave are
+ * independent and are solved together: every pass splits all of their index ranges
+ * into chunks that the worker threads pull from a shared counter. Inside a slice the
+ * results are propagated backwards from the terminal positions (a position is a win
+ * if some move reaches a lost position, a loss if every move reaches a won one) until
+ * a pass changes nothing; whatever is left undecided is a draw.
+ *
+ * Finished slices stay in memory until the memory budget is used up; after that they
+ * are spilled to disk and read back through mmap, so the page cache decides what stays
+ * resident.
+ */
+class TablebaseGenerator {
+private:
+    static const uint64_t CHUNK_POSITIONS = 1 << 14; // Multiple of 4, so threads never share a byte
+
+    // A slice that is still being solved; results are bit-packed into atomic bytes
+    struct ActiveSlice {
+        SliceKey key;
+        uint64_t count;
+        std::vector<std::atomic<uint8_t> > results;
+        std::atomic<bool> changed;
+        int passes;
+
+        explicit ActiveSlice(const SliceKey& k)
+            : key(k), count(k.positionCount()), results((size_t)((k.positionCount() + 3) / 4)), changed(false), passes(0) {
+            for (size_t i = 0; i < results.size(); ++i) results[i].store(0xFF, std::memory_order_relaxed);
+        }
+
+        int get(uint64_t index) const {
+            return (results[index >> 2].load(std::memory_order_relaxed) >> ((index & 3) * 2)) & 3;
+        }
+
+        // Only the thread that owns the chunk containing 'index' writes its byte
+        void set(uint64_t index, int value) {
+            std::atomic<uint8_t>& byte = results[index >> 2];
+            int shift = (int)(index & 3) * 2;
+            byte.store((uint8_t)((byte.load(std::memory_order_relaxed) & ~(3 << shift)) | (value << shift)),
+                       std::memory_order_relaxed);
+        }
+    };
+
+    // A solved slice, either held in memory or spilled to disk and mapped back
+    struct SolvedSlice {
+        std::vector<uint8_t> memory;
+        MappedFile spill;
+        const uint8_t* data;
+        size_t bytes;
+    };
+
+    struct Chunk {
+        ActiveSlice* slice;
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    int maxPieces;
+    int threadCount;
+    uint64_t memoryBudget; // Bytes of solved slices kept in RAM before spilling
+    uint64_t memoryUsed;
+    std::string spillPrefix;
+    std::vector<SliceKey> order;
+    std::map<uint32_t, std::unique_ptr<SolvedSlice> > solved;
+
+    // Result of a position in an already solved slice
+    int lookup(const Position& pos) const {
+        if (pos.own() == 0) return TB_LOSS;
+        SliceKey key = sliceKeyOf(pos);
+        std::map<uint32_t, std::unique_ptr<SolvedSlice> >::const_iterator it = solved.find(key.packed());
+        if (it == solved.end()) return TB_UNKNOWN;
+        return getPackedResult(it->second->data, tablebaseIndex(pos, key));
+    }
+
+    // One backward-propagation step for a single position
+    int resolve(const Position& pos, const ActiveSlice& slice) const {
+        MoveList moves;
+        if (generateMoves(pos, moves) == 0) return TB_LOSS;
+
+        bool everyMoveLoses = true;
+        for (int i = 0; i < moves.count; ++i) {
+            Position next = applyMove(pos, moves.moves[i]);
+            SliceKey nextKey = sliceKeyOf(next);
+            int value = (nextKey.packed() == slice.key.packed()) ? slice.get(tablebaseIndex(next, slice.key))
+                                                                 : lookup(next);
+            if (value == TB_LOSS) return TB_WIN;
+            if (value != TB_WIN) everyMoveLoses = false;
+        }
+        return everyMoveLoses ? TB_LOSS : TB_UNKNOWN;
+    }
+
+    void solveChunk(const Chunk& chunk) const {
+        bool changed = false;
+        for (uint64_t index = chunk.begin; index < chunk.end; ++index) {
+            if (chunk.slice->get(index) != TB_UNKNOWN) continue;
+            Position pos;
+            int value = positionFromIndex(chunk.slice->key, index, pos) ? resolve(pos, *chunk.slice) : TB_DRAW;
+            if (value != TB_UNKNOWN) {
+                chunk.slice->set(index, value);
+                changed = true;
+            }
+        }
+        if (changed) chunk.slice->changed.store(true, std::memory_order_relaxed);
+    }
+
+    // Runs one pass over every active slice of a wave on all worker threads
+    void runPass(const std::vector<ActiveSlice*>& active) const {
+        std::vector<Chunk> chunks;
+        for (size_t i = 0; i < active.size(); ++i) {
+            active[i]->changed.store(false, std::memory_order_relaxed);
+            active[i]->passes++;
+            for (uint64_t begin = 0; begin < active[i]->count; begin += CHUNK_POSITIONS) {
+                Chunk chunk = {active[i], begin, std::min(begin + CHUNK_POSITIONS, active[i]->count)};
+                chunks.push_back(chunk);
+            }
+        }
+
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        int workerCount = (int)std::min<size_t>((size_t)threadCount, chunks.size());
+        for (int t = 0; t < workerCount; ++t) {
+            workers.push_back(std::thread([&]() {
+                for (size_t c = next.fetch_add(1); c < chunks.size(); c = next.fetch_add(1)) {
+                    solveChunk(chunks[c]);
+                }
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    }
+
+    // Turns the remaining unknowns into draws, reports, and stores (or spills) the slice
+    bool finishSlice(ActiveSlice& slice, std::chrono::steady_clock::time_point waveStart) {
+        std::unique_ptr<SolvedSlice> result(new SolvedSlice());
+        result->memory.resize(slice.results.size());
+        uint64_t wins = 0, losses = 0, draws = 0;
+        for (uint64_t index = 0; index < slice.count; ++index) {
+            int value = slice.get(index);
+            if (value == TB_UNKNOWN) value = TB_DRAW;
+            setPackedResult(result->memory.data(), index, value);
+            if (value == TB_WIN) ++wins;
+            else if (value == TB_LOSS) ++losses;
+            else ++draws;
+        }
+        std::vector<std::atomic<uint8_t> >().swap(slice.results);
+
+        result->bytes = result->memory.size();
+        result->data = result->memory.data();
+        bool spilled = false;
+        if (memoryUsed + result->bytes > memoryBudget) {
+            std::string path = spillPrefix + "." + std::to_string(slice.key.packed()) + ".spill";
+            FILE* out = std::fopen(path.c_str(), "wb");
+            bool ok = out && std::fwrite(result->memory.data(), 1, result->bytes, out) == result->bytes;
+            if (out && std::fclose(out) != 0) ok = false;
+            if (!ok || !result->spill.open(path)) {
+                std::cerr << "Could not spill slice to " << path << std::endl;
+                return false;
+            }
+            std::remove(path.c_str()); // The mapping keeps the data alive until it is closed
+            std::vector<uint8_t>().swap(result->memory);
+            result->data = result->spill.data();
+            spilled = true;
+        } else {
+            memoryUsed += result->bytes;
+        }
+        solved[slice.key.packed()] = std::move(result);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - waveStart).count();
+        double rate = (seconds > 0.0) ? slice.count / seconds : 0.0;
+        std::cout << "Slice R" << slice.key.redMen << "+" << slice.key.redKings << "K vs B" << slice.key.blackMen << "+"
+                  << slice.key.blackKings << "K: " << slice.count << " indices, " << wins << " wins, " << losses
+                  << " losses, " << draws << " draws/unused, " << slice.passes << " passes, " << seconds << "s, "
+                  << (uint64_t)rate << " positions/s, peak RSS " << peakResidentMegabytes() << " MB"
+                  << (spilled ? ", spilled to disk" : "") << "\n";
+        return true;
+    }
+
+public:
+    TablebaseGenerator(int pieces, int threads, uint64_t memoryBudgetMegabytes, const std::string& spillPath)
+        : maxPieces(std::min(std::max(pieces, 2), TB_MAX_PIECES)),
+          threadCount(std::max(threads, 1)),
+          memoryBudget(memoryBudgetMegabytes * 1024 * 1024),
+          memoryUsed(0),
+          spillPrefix(spillPath) {
+        for (int rm = 0; rm <= maxPieces; ++rm)
+            for (int rk = 0; rm + rk <= maxPieces; ++rk)
+                for (int bm = 0; rm + rk + bm <= maxPieces; ++bm)
+                    for (int bk = 0; rm + rk + bm + bk <= maxPieces; ++bk) {
+                        if (rm + rk == 0 || bm + bk == 0) continue;
+                        SliceKey key = {rm, rk, bm, bk};
+                        order.push_back(key);
+                    }
+        std::stable_sort(order.begin(), order.end(), [](const SliceKey& a, const SliceKey& b) {
+            if (a.pieces() != b.pieces()) return a.pieces() < b.pieces();
+            return a.men() < b.men();
+        });
+    }
+
+    bool generate() {
+        size_t waveBegin = 0;
+        while (waveBegin < order.size()) {
+            size_t waveEnd = waveBegin;
+            while (waveEnd < order.size() && order[waveEnd].pieces() == order[waveBegin].pieces() &&
+                   order[waveEnd].men() == order[waveBegin].men()) {
+                ++waveEnd;
+            }
+
+            std::chrono::steady_clock::time_point waveStart = std::chrono::steady_clock::now();
+            std::vector<std::unique_ptr<ActiveSlice> > wave;
+            std::vector<ActiveSlice*> active;
+            for (size_t i = waveBegin; i < waveEnd; ++i) {
+                wave.push_back(std::unique_ptr<ActiveSlice>(new ActiveSlice(order[i])));
+                active.push_back(wave.back().get());
+            }
+
+            // A slice whose pass changed nothing has converged and leaves the wave
+            while (!active.empty()) {
+                runPass(active);
+                std::vector<ActiveSlice*> stillChanging;
+                for (size_t i = 0; i < active.size(); ++i) {
+                    if (active[i]->changed.load()) {
+                        stillChanging.push_back(active[i]);
+                    } else if (!finishSlice(*active[i], waveStart)) {
+                        return false;
+                    }
+                }
+                active.swap(stillChanging);
+            }
+            waveBegin = waveEnd;
+        }
+        return true;
+    }
+
+    bool write(const std::string& path) const {
+        FILE* out = std::fopen(path.c_str(), "wb");
+        if (!out) return false;
+
+        TablebaseFileHeader header;
+        std::memcpy(header.magic, TB_MAGIC, sizeof(header.magic));
+        header.maxPieces = (uint32_t)maxPieces;
+        header.sliceCount = (uint32_t)order.size();
+        header.blockPositions = TB_BLOCK_POSITIONS;
+        header.reserved = 0;
+
+        std::vector<TablebaseSliceRecord> records(order.size());
+        uint64_t offset = sizeof(header) + records.size() * sizeof(TablebaseSliceRecord);
+        for (size_t i = 0; i < order.size(); ++i) {
+            records[i].key = order[i].packed();
+            records[i].positionCount = order[i].positionCount();
+            records[i].blockCount = (uint32_t)((records[i].positionCount + TB_BLOCK_POSITIONS - 1) / TB_BLOCK_POSITIONS);
+            records[i].blockTableOffset = offset;
+            offset += (records[i].blockCount + 1) * sizeof(uint64_t);
+        }
+
+        // The offset tables are written as placeholders first; each block is compressed
+        // and streamed out on its own, so only one block is ever held in memory, and the
+        // tables are filled in at the end
+        const uint64_t tablesOffset = sizeof(header) + records.size() * sizeof(TablebaseSliceRecord);
+        std::vector<uint64_t> blockTable((offset - tablesOffset) / sizeof(uint64_t), 0); // All slices' tables in file order
+        bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+        ok = ok && std::fwrite(records.data(), sizeof(TablebaseSliceRecord), records.size(), out) == records.size();
+        ok = ok && std::fwrite(blockTable.data(), sizeof(uint64_t), blockTable.size(), out) == blockTable.size();
+
+        const size_t blockBytes = TB_BLOCK_POSITIONS / 4;
+        std::vector<uint8_t> block(blockBytes);
+        std::vector<uint8_t> compressed;
+        size_t entry = 0;
+        for (size_t i = 0; ok && i < order.size(); ++i) {
+            const SolvedSlice& results = *solved.find(records[i].key)->second;
+            for (uint32_t b = 0; ok && b < records[i].blockCount; ++b) {
+                blockTable[entry++] = offset;
+                size_t begin = (size_t)b * blockBytes;
+                std::fill(block.begin(), block.end(), 0);
+                std::memcpy(block.data(), results.data + begin, std::min(blockBytes, results.bytes - begin));
+                compressed.clear();
+                compressBlock(block.data(), block.size(), compressed);
+                ok = std::fwrite(compressed.data(), 1, compressed.size(), out) == compressed.size();
+                offset += compressed.size();
+            }
+            blockTable[entry++] = offset;
+        }
+
+        ok = ok && std::fseek(out, (long)tablesOffset, SEEK_SET) == 0;
+        ok = ok && std::fwrite(blockTable.data(), sizeof(uint64_t), blockTable.size(), out) == blockTable.size();
+        return std::fclose(out) == 0 && ok;
+    }
+};
+
+/**
+ * @class Tablebase
+ * @brief Runtime prober for a generated tablebase file.
+ *
+ * The file is memory-mapped, so only the blocks that are actually probed are read
+ * from disk; decompressed blocks are kept in a small LRU cache. The cache is split
+ * into shards by block, each with its own lock, so searches on many threads rarely
+ * wait for one another.
+ */
+class Tablebase {
+private:
+    struct CachedBlock {
+        uint32_t key;
+        uint32_t block;
+        uint64_t lastUsed; // 0 marks an empty slot
+        uint8_t data[TB_BLOCK_POSITIONS / 4];
+    };
+
+    struct CacheShard {
+        std::mutex mutex;
+        CachedBlock blocks[TB_CACHE_BLOCKS];
+        uint64_t tick;
+    };
+
+    MappedFile file;
+    int pieceLimit;
+    std::vector<int> sliceByKey; // Packed SliceKey -> slice directory index, or -1
+    const TablebaseSliceRecord* slices;
+    uint64_t blockDataOffset; // End of the last offset table; all block data lies past it
+    std::unique_ptr<CacheShard[]> shards;
+
+    static size_t shardOf(uint32_t key, uint32_t block) {
+        return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull + block) * 0xBF58476D1CE4E5B9ull >> 60) % TB_CACHE_SHARDS;
+    }
+
+    // Called with shard.mutex held
+    const uint8_t* loadBlock(CacheShard& shard, const TablebaseSliceRecord& slice, uint32_t block) {
+        CachedBlock* victim = &shard.blocks[0];
+        for (int i = 0; i < TB_CACHE_BLOCKS; ++i) {
+            CachedBlock& entry = shard.blocks[i];
+            if (entry.lastUsed && entry.key == slice.key && entry.block == block) {
+                entry.lastUsed = ++shard.tick;
+                return entry.data;
+            }
+            if (entry.lastUsed < victim->lastUsed) victim = &entry;
+        }
+
+        if (block >= slice.blockCount) return nullptr;
+        uint64_t offsets[2];
+        std::memcpy(offsets, file.data() + slice.blockTableOffset + block * sizeof(uint64_t), sizeof(offsets));
+        if (offsets[0] < blockDataOffset || offsets[1] < offsets[0] || offsets[1] > file.size()) return nullptr;
+        if (!decompressBlock(file.data() + offsets[0], (size_t)(offsets[1] - offsets[0]), victim->data, sizeof(victim->data))) {
+            return nullptr;
+        }
+        victim->key = slice.key;
+        victim->block = block;
+        victim->lastUsed = ++shard.tick;
+        return victim->data;
+    }
+
+public:
+    Tablebase() : pieceLimit(0), slices(nullptr), blockDataOffset(0), shards(new CacheShard[TB_CACHE_SHARDS]) {}
+
+    bool open(const std::string& path) {
+        if (!file.open(path) || file.size() < sizeof(TablebaseFileHeader)) return false;
+        TablebaseFileHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, TB_MAGIC, sizeof(header.magic)) != 0 || header.blockPositions != TB_BLOCK_POSITIONS ||
+            header.maxPieces > (uint32_t)TB_MAX_PIECES || sizeof(header) + (uint64_t)header.sliceCount * sizeof(TablebaseSliceRecord) > file.size()) {
+            file.close();
+            return false;
+        }
+
+        pieceLimit = (int)header.maxPieces;
+        slices = (const TablebaseSliceRecord*)(file.data() + sizeof(header));
+        blockDataOffset = sizeof(header) + (uint64_t)header.sliceCount * sizeof(TablebaseSliceRecord);
+        // Every offset table must lie inside the file and every slice must fit the piece
+        // limit, so a truncated or corrupt file is rejected here instead of being read out
+        // of bounds by loadBlock() or the index tables
+        for (uint32_t i = 0; i < header.sliceCount; ++i) {
+            uint32_t key = slices[i].key;
+            int redMen = key & 0xF, redKings = (key >> 4) & 0xF, blackMen = (key >> 8) & 0xF, blackKings = (key >> 12) & 0xF;
+            uint64_t tableBytes = ((uint64_t)slices[i].blockCount + 1) * sizeof(uint64_t);
+            if ((key >> 16) != 0 || redMen > 12 || blackMen > 12 || redMen + redKings + blackMen + blackKings > pieceLimit ||
+                slices[i].blockTableOffset > file.size() || tableBytes > file.size() - slices[i].blockTableOffset) {
+                file.close();
+                slices = nullptr;
+                return false;
+            }
+            blockDataOffset = std::max(blockDataOffset, slices[i].blockTableOffset + tableBytes);
+        }
+        sliceByKey.assign(1 << 16, -1);
+        for (uint32_t i = 0; i < header.sliceCount; ++i) {
+            sliceByKey[slices[i].key & 0xFFFF] = (int)i;
+        }
+        for (int i = 0; i < TB_CACHE_SHARDS; ++i) {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            shards[i].tick = 0;
+            for (int b = 0; b < TB_CACHE_BLOCKS; ++b) shards[i].blocks[b].lastUsed = 0;
+        }
+        return true;
+    }
+
+    bool isOpen() const { return file.isOpen(); }
+    int maxPieces() const { return pieceLimit; }
+
+    // Looks up the result for the side to move; returns false if the position is not covered
+    bool probe(const Position& pos, int& result) {
+        if (!file.isOpen() || popCount(pos.occupied()) > pieceLimit) return false;
+        if (pos.own() == 0) { result = TB_LOSS; return true; }
+        if (pos.enemies() == 0) { result = TB_WIN; return true; }
+
+        SliceKey key = sliceKeyOf(pos);
+        int slot = sliceByKey[key.packed()];
+        if (slot < 0) return false;
+
+        uint64_t index = tablebaseIndex(pos, key);
+        uint32_t blockNumber = (uint32_t)(index / TB_BLOCK_POSITIONS);
+        CacheShard& shard = shards[shardOf(slices[slot].key, blockNumber)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const uint8_t* block = loadBlock(shard, slices[slot], blockNumber);
+        if (!block) return false;
+        result = getPackedResult(block, index % TB_BLOCK_POSITIONS);
+        return true;
+    }
+};
+
+// --- 7. POSITION HASHING AND MOVE NOTATION ---
+
+/**
+ * @struct ZobristKeys
+ * @brief Random keys for incremental position hashing (fixed seed, so hashes are
+ * stable across runs and can be stored in book and index files).
+ */
+struct ZobristKeys {
+    uint64_t piece[4][NUM_SQUARES]; // RED man, RED king, BLACK man, BLACK king
+    uint64_t blackToMove;
+
+    ZobristKeys() {
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (int t = 0; t < 4; ++t) {
+            for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+                piece[t][sq] = next(state);
+            }
+        }
+        blackToMove = next(state);
+    }
+
+    // SplitMix64 generator
+    static uint64_t next(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+const ZobristKeys ZOBRIST;
+
+uint64_t hashPosition(const Position& pos) {
+    uint64_t hash = (pos.sideToMove == BLACK) ? ZOBRIST.blackToMove : 0;
+    for (uint32_t bits = pos.red & ~pos.kings; bits; bits &= bits - 1) hash ^= ZOBRIST.piece[0][lowestSquare(bits)];
+    for (uint32_t bits = pos.red & pos.kings; bits; bits &= bits - 1) hash ^= ZOBRIST.piece[1][lowestSquare(bits)];
+    for (uint32_t bits = pos.black & ~pos.kings; bits; bits &= bits - 1) hash ^= ZOBRIST.piece[2][lowestSquare(bits)];
+    for (uint32_t bits = pos.black & pos.kings; bits; bits &= bits - 1) hash ^= ZOBRIST.piece[3][lowestSquare(bits)];
+    return hash;
+}
+
+// Zobrist index of the piece on 'sq' (which must be occupied)
+inline int zobristPiece(const Position& pos, int sq) {
+    uint32_t bit = 1u << sq;
+    return ((pos.black & bit) ? 2 : 0) + ((pos.kings & bit) ? 1 : 0);
+}
+
+// hashPosition(next) computed from hashPosition(pos), where next = applyMove(pos, move)
+uint64_t hashAfterMove(uint64_t hash, const Position& pos, const FullMove& move, const Position& next) {
+    hash ^= ZOBRIST.blackToMove;
+    hash ^= ZOBRIST.piece[zobristPiece(pos, move.from)][move.from];
+    hash ^= ZOBRIST.piece[zobristPiece(next, move.to)][move.to];
+    for (uint32_t bits = move.captures; bits; bits &= bits - 1) {
+        int sq = lowestSquare(bits);
+        hash ^= ZOBRIST.piece[zobristPiece(pos, sq)][sq];
+    }
+    return hash;
+}
+
+// A capture or a man move (including a promotion) can never be undone, so no position
+// before it can occur again
+inline bool irreversibleStep(const Position& before, const Position& after) {
+    return popCount(before.occupied()) != popCount(after.occupied()) ||
+           (before.red & ~before.kings) != (after.red & ~after.kings) ||
+           (before.black & ~before.kings) != (after.black & ~after.kings);
+}
+
+const int NO_PROGRESS_PLIES = 80; // 40 moves each without a capture or man move is a draw
+
+/**
+ * @class PositionHistory
+ * @brief Hashes of the positions of a game (and of the search path below it) for draw detection.
+ *
+ * Each entry also records how many plies have passed since the last irreversible step,
+ * so a repetition check only looks back that far, and only at every second entry
+ * (the same side to move), instead of over the whole game.
+ */
+class PositionHistory {
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t quietPlies; // Plies since the last capture or man move
+    };
+
+    std::vector<Entry> entries;
+    int noProgressLimit; // 0 disables the no-progress rule
+
+public:
+    explicit PositionHistory(int noProgressPlies = NO_PROGRESS_PLIES) : noProgressLimit(noProgressPlies) {}
+
+    // Starts a new game (or search) at the position with hash 'key'
+    void reset(uint64_t key) {
+        entries.clear();
+        push(key, true);
+    }
+
+    void push(uint64_t key, bool irreversible) {
+        Entry entry;
+        entry.key = key;
+        entry.quietPlies = (irreversible || entries.empty()) ? 0 : entries.back().quietPlies + 1;
+        entries.push_back(entry);
+    }
+
+    void pop() { entries.pop_back(); }
+
+    // Drops every entry after the first 'count', e.g. when moves are taken back
+    void truncate(size_t count) {
+        if (count < entries.size()) entries.resize(count);
+    }
+
+    size_t size() const { return entries.size(); }
+    uint64_t lastKey() const { return entries.back().key; }
+
+    void setNoProgressLimit(int plies) { noProgressLimit = plies; }
+
+    // How many times the current position occurred before
+    int repetitions() const {
+        int count = 0;
+        size_t top = entries.size() - 1;
+        for (size_t back = 2; back <= entries[top].quietPlies; back += 2) {
+            if (entries[top - back].key == entries[top].key) ++count;
+        }
+        return count;
+    }
+
+    bool noProgress() const {
+        return noProgressLimit > 0 && (int)entries.back().quietPlies >= noProgressLimit;
+    }
+
+    // Game rule: a position occurring for the third time or the no-progress limit
+    bool isDrawn() const { return repetitions() >= 2 || noProgress(); }
+};
+
+// The starting position set up by Board::initializeBoard()
+Position initialPosition() {
+    Position pos = {0xFFF00000u, 0x00000FFFu, 0, RED};
+    return pos;
+}
+
+// Board coordinates as typed at the prompt, e.g. "C6"
+std::string squareName(int sq) {
+    std::string name;
+    name += (char)('A' + squareCol(sq));
+    name += (char)('1' + squareRow(sq));
+    return name;
+}
+
+// Standard numeric notation: "22-18" for a simple move, "22x15x6" for a jump
+std::string moveToString(const FullMove& move) {
+    std::string text = std::to_string(move.from + 1);
+    if (!move.isCapture()) {
+        return text + "-" + std::to_string(move.to + 1);
+    }
+    for (int i = 0; i < move.pathLength; ++i) {
+        text += "x" + std::to_string(move.path[i] + 1);
+    }
+    return text;
+}
+
+// Matches numeric notation against the legal moves; "22x6" picks the first
+// sequence between the two squares, "22x15x6" also pins the path.
+bool parseMove(const Position& pos, const char* text, size_t length, FullMove& move) {
+    int squares[MAX_JUMP_PATH + 1];
+    int count = 0;
+    size_t i = 0;
+    while (i < length) {
+        if (text[i] < '0' || text[i] > '9' || count > MAX_JUMP_PATH) return false;
+        int value = 0;
+        while (i < length && text[i] >= '0' && text[i] <= '9' && value <= NUM_SQUARES) value = value * 10 + (text[i++] - '0');
+        if (value < 1 || value > NUM_SQUARES) return false;
+        squares[count++] = value - 1;
+        if (i < length) {
+            if (text[i] != '-' && text[i] != 'x' && text[i] != 'X' && text[i] != ':') return false;
+            ++i;
+        }
+    }
+    if (count < 2) return false;
+
+    MoveList moves;
+    generateMoves(pos, moves);
+    for (int m = 0; m < moves.count; ++m) {
+        const FullMove& candidate = moves.moves[m];
+        if (candidate.from != squares[0] || candidate.to != squares[count - 1]) continue;
+        bool pathMatches = true;
+        if (count > 2) {
+            pathMatches = candidate.pathLength == count - 1;
+            for (int k = 1; pathMatches && k < count; ++k) {
+                pathMatches = candidate.path[k - 1] == squares[k];
+            }
+        }
+        if (pathMatches) {
+            move = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseMove(const Position& pos, const std::string& text, FullMove& move) {
+    return parseMove(pos, text.data(), text.size(), move);
+}
+
+// Position strings look like "R:R21,22,K30:B1,2,K9": the side to move, then the
+// RED and BLACK pieces by square number, kings prefixed with K. "W" is accepted for
+// RED so PDN FEN strings (White on squares 21-32) load unchanged.
+const size_t MAX_POSITION_STRING = 128;
+
+// Parses a position string without allocating; rejects malformed or impossible
+// positions (duplicate squares, men standing on their crown row).
+bool parsePosition(const char* text, size_t length, Position& pos) {
+    const char* p = text;
+    const char* end = text + length;
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '"')) ++p;
+    while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n' ||
+                       end[-1] == '"' || end[-1] == '.')) {
+        --end;
+    }
+    if (p >= end) return false;
+
+    pos.red = pos.black = pos.kings = 0;
+    char side = (char)std::toupper((unsigned char)*p++);
+    if (side == 'R' || side == 'W') pos.sideToMove = RED;
+    else if (side == 'B') pos.sideToMove = BLACK;
+    else return false;
+
+    while (p < end) {
+        if (*p++ != ':' || p >= end) return false;
+        char color = (char)std::toupper((unsigned char)*p++);
+        uint32_t* pieces = (color == 'R' || color == 'W') ? &pos.red : (color == 'B') ? &pos.black : nullptr;
+        if (!pieces) return false;
+
+        while (p < end && *p != ':') {
+            bool isKing = false;
+            if (*p == 'K' || *p == 'k') {
+                isKing = true;
+                ++p;
+            }
+            int number = 0;
+            const char* digits = p;
+            while (p < end && *p >= '0' && *p <= '9' && p - digits < 2) number = number * 10 + (*p++ - '0');
+            if (p == digits || number < 1 || number > NUM_SQUARES) return false;
+            if (p < end && *p != ',' && *p != ':') return false;
+
+            uint32_t bit = 1u << (number - 1);
+            if ((pos.red | pos.black) & bit) return false;
+            uint32_t crownRow = (pieces == &pos.red) ? RED_CROWN_ROW : BLACK_CROWN_ROW;
+            if (!isKing && (bit & crownRow)) return false;
+            *pieces |= bit;
+            if (isKing) pos.kings |= bit;
+
+            if (p < end && *p == ',') {
+                ++p;
+                if (p >= end || *p == ':') return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool parsePosition(const std::string& text, Position& pos) {
+    return parsePosition(text.data(), text.size(), pos);
+}
+
+// Writes the position string into 'out' (at least MAX_POSITION_STRING bytes) and
+// returns its length; no terminating zero is written.
+size_t formatPosition(const Position& pos, char* out) {
+    char* p = out;
+    *p++ = (pos.sideToMove == RED) ? 'R' : 'B';
+    for (int group = 0; group < 2; ++group) {
+        *p++ = ':';
+        *p++ = (group == 0) ? 'R' : 'B';
+        bool first = true;
+        for (uint32_t bits = (group == 0) ? pos.red : pos.black; bits; bits &= bits - 1) {
+            int sq = lowestSquare(bits);
+            if (!first) *p++ = ',';
+            first = false;
+            if ((pos.kings >> sq) & 1u) *p++ = 'K';
+            int number = sq + 1;
+            if (number >= 10) *p++ = (char)('0' + number / 10);
+            *p++ = (char)('0' + number % 10);
+        }
+    }
+    return (size_t)(p - out);
+}
+
+std::string positionToString(const Position& pos) {
+    char buffer[MAX_POSITION_STRING];
+    return std::string(buffer, formatPosition(pos, buffer));
+}
+
+// Outcome of a finished (or abandoned) game
+enum GameResult {
+    RESULT_UNKNOWN = 0,
+    RESULT_RED_WINS = 1,
+    RESULT_BLACK_WINS = 2,
+    RESULT_DRAW = 3
+};
+
+/**
+ * @struct GameRecord
+ * @brief Start position, the full-turn moves played and the result.
+ */
+struct GameRecord {
+    Position start;
+    std::vector<FullMove> moves;
+    GameResult result;
+};
+
+// Result strings follow PDN, with "1-0" meaning RED (the side that moves first) won
+const char* resultToString(GameResult result) {
+    switch (result) {
+        case RESULT_RED_WINS: return "1-0";
+        case RESULT_BLACK_WINS: return "0-1";
+        case RESULT_DRAW: return "1/2-1/2";
+        default: return "*";
+    }
+}
+
+GameResult resultFromString(const std::string& text) {
+    if (text == "1-0" || text == "2-0") return RESULT_RED_WINS;
+    if (text == "0-1" || text == "0-2") return RESULT_BLACK_WINS;
+    if (text == "1/2-1/2" || text == "1-1") return RESULT_DRAW;
+    return RESULT_UNKNOWN;
+}
+
+// --- 8. PDN GAME RECORDS ---
+
+/**
+ * @struct GameCollector
+ * @brief PdnReader visitor that keeps the moves of the current game.
+ */
+struct GameCollector {
+    GameRecord* game;
+    bool valid;
+
+    void beginGame(const Position& start) {
+        game->start = start;
+        game->moves.clear();
+        game->result = RESULT_UNKNOWN;
+    }
+
+    void onMove(const Position&, const FullMove& move, const Position&) {
+        game->moves.push_back(move);
+    }
+
+    void endGame(GameResult result, bool allMovesLegal) {
+        game->result = result;
+        valid = allMovesLegal;
+    }
+};
+
+/**
+ * @class PdnReader
+ * @brief Streaming PDN parser over an in-memory (usually mmap'd) byte range.
+ *
+ * Nothing is materialized per game: tags other than FEN and Result are skipped,
+ * every move is validated against the move generator, and the visitor sees each
+ * position as soon as it has been reached. A visitor provides
+ * beginGame(start), onMove(before, move, after) and endGame(result, valid).
+ */
+class PdnReader {
+private:
+    const char* cursor;
+    const char* end;
+
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    static bool isDelimiter(char c) {
+        return isSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ';';
+    }
+
+    void skipSpace() {
+        while (cursor < end && isSpace(*cursor)) ++cursor;
+    }
+
+    void skipPast(char closing) {
+        while (cursor < end && *cursor != closing) ++cursor;
+        if (cursor < end) ++cursor;
+    }
+
+    void skipVariation() {
+        int depth = 0;
+        while (cursor < end) {
+            char c = *cursor++;
+            if (c == '(') ++depth;
+            else if (c == ')' && --depth == 0) return;
+            else if (c == '{') skipPast('}');
+        }
+    }
+
+    // Reads [Name "Value"]; only FEN and Result matter to us
+    void readTag(Position& start, bool& haveStart, GameResult& tagResult) {
+        ++cursor; // '['
+        const char* name = cursor;
+        while (cursor < end && !isSpace(*cursor) && *cursor != ']') ++cursor;
+        size_t nameLength = (size_t)(cursor - name);
+        while (cursor < end && *cursor != '"' && *cursor != ']') ++cursor;
+        const char* value = cursor;
+        size_t valueLength = 0;
+        if (cursor < end && *cursor == '"') {
+            value = ++cursor;
+            while (cursor < end && *cursor != '"') ++cursor;
+            valueLength = (size_t)(cursor - value);
+        }
+        skipPast(']');
+
+        if (nameLength == 3 && std::memcmp(name, "FEN", 3) == 0) {
+            haveStart = parsePosition(value, valueLength, start);
+        } else if (nameLength == 6 && std::memcmp(name, "Result", 6) == 0) {
+            tagResult = resultFromString(std::string(value, valueLength));
+        }
+    }
+
+public:
+    PdnReader(const char* begin, const char* finish) : cursor(begin), end(finish) {}
+
+    size_t remaining() const { return (size_t)(end - cursor); }
+
+    // Streams the next game into the visitor; returns false once the input is exhausted
+    template <typename Visitor>
+    bool readGame(Visitor& visitor) {
+        skipSpace();
+        if (cursor >= end) return false;
+
+        Position start = initialPosition();
+        bool haveStart = false;
+        GameResult tagResult = RESULT_UNKNOWN;
+        while (cursor < end && *cursor == '[') {
+            readTag(start, haveStart, tagResult);
+            skipSpace();
+        }
+
+        Position pos = start;
+        bool begun = false;
+        bool valid = true;
+        GameResult result = RESULT_UNKNOWN;
+        while (true) {
+            skipSpace();
+            if (cursor >= end || *cursor == '[') break; // Next game without a result token
+            char c = *cursor;
+            if (c == '{') { skipPast('}'); continue; }
+            if (c == '(') { skipVariation(); continue; }
+            if (c == ';') { skipPast('\n'); continue; }
+
+            const char* token = cursor;
+            while (cursor < end && !isDelimiter(*cursor)) ++cursor;
+            size_t length = (size_t)(cursor - token);
+            if (length == 0) { ++cursor; continue; } // Stray ')' or '}'
+
+            if (*token == '*') break;
+            if (length >= 3 && length <= 7 && (token[1] == '-' || token[1] == '/')) {
+                GameResult tokenResult = resultFromString(std::string(token, length));
+                if (tokenResult != RESULT_UNKNOWN) {
+                    result = tokenResult;
+                    break;
+                }
+            }
+            if (*token == '$') continue; // Numeric annotation glyph
+
+            // Strip a move number glued to the move ("12.22-18") and trailing "!?" annotations
+            const char* dot = (const char*)std::memchr(token, '.', length);
+            while (dot) {
+                length -= (size_t)(dot + 1 - token);
+                token = dot + 1;
+                dot = (const char*)std::memchr(token, '.', length);
+            }
+            while (length > 0 && (token[length - 1] == '!' || token[length - 1] == '?')) --length;
+            if (length == 0 || !valid) continue;
+
+            FullMove move;
+            bool legal = parseMove(pos, token, length, move);
+            // Standard archives let Black move first; accept that when there is no FEN tag
+            if (!legal && !begun && !haveStart) {
+                Position blackFirst = pos;
+                blackFirst.sideToMove = BLACK;
+                if (parseMove(blackFirst, token, length, move)) {
+                    pos = start = blackFirst;
+                    legal = true;
+                }
+            }
+            if (!begun) {
+                visitor.beginGame(start);
+                begun = true;
+            }
+            if (!legal) {
+                valid = false;
+                continue;
+            }
+            Position next = applyMove(pos, move);
+            visitor.onMove(pos, move, next);
+            pos = next;
+        }
+
+        if (!begun) visitor.beginGame(start);
+        visitor.endGame(result != RESULT_UNKNOWN ? result : tagResult, valid);
+        return true;
+    }
+
+    // Convenience wrapper that collects the whole game; 'valid' reports whether every move was legal
+    bool nextGame(GameRecord& game, bool& valid) {
+        GameCollector collector = {&game, true};
+        if (!readGame(collector)) return false;
+        valid = collector.valid; // Moves after an illegal one are not collected
+        return true;
+    }
+};
+
+// Splits a PDN buffer into roughly equal pieces that each start at a game's first tag
+std::vector<const char*> splitPdnChunks(const char* begin, const char* end, int pieces) {
+    std::vector<const char*> bounds(1, begin);
+    size_t size = (size_t)(end - begin);
+    for (int i = 1; i < pieces; ++i) {
+        const char* p = std::max(begin + size * i / pieces, bounds.back());
+        while (p < end && !(*p == '[' && p > begin && p[-1] == '\n' && end - p > 6 && std::memcmp(p, "[Event", 6) == 0)) {
+            const void* next = std::memchr(p + 1, '[', (size_t)(end - p - 1));
+            p = next ? (const char*)next : end;
+        }
+        bounds.push_back(p);
+    }
+    bounds.push_back(end);
+    return bounds;
+}
+
+// Appends one game in PDN, numbering moves and wrapping lines at about 80 columns
+void appendPdnGame(std::string& out, const GameRecord& game, const std::string& event) {
+    out += "[Event \"" + event + "\"]\n";
+    if (!(game.start == initialPosition())) {
+        out += "[FEN \"" + positionToString(game.start) + "\"]\n";
+    }
+    out += "[Result \"";
+    out += resultToString(game.result);
+    out += "\"]\n";
+
+    size_t lineStart = out.size();
+    Player side = game.start.sideToMove;
+    for (size_t i = 0; i < game.moves.size(); ++i) {
+        std::string token;
+        if (i == 0 || side == game.start.sideToMove) {
+            token = std::to_string(i / 2 + 1) + (side == game.start.sideToMove ? ". " : "... ");
+        }
+        token += moveToString(game.moves[i]);
+        if (out.size() - lineStart + token.size() > 79) {
+            out += '\n';
+            lineStart = out.size();
+        } else if (out.size() > lineStart) {
+            out += ' ';
+        }
+        out += token;
+        side = opponentOf(side);
+    }
+    if (out.size() > lineStart) out += ' ';
+    out += resultToString(game.result);
+    out += "\n\n";
+}
+
+/**
+ * @class PdnWriter
+ * @brief Buffered PDN output; games are formatted into memory and written in large blocks.
+ */
+class PdnWriter {
+private:
+    static const size_t FLUSH_BYTES = 1 << 16;
+    FILE* out;
+    std::string buffer;
+    bool ok;
+
+public:
+    explicit PdnWriter(const std::string& path) : out(std::fopen(path.c_str(), "wb")), ok(out != nullptr) {}
+
+    ~PdnWriter() {
+        close();
+    }
+
+    bool isOpen() const { return out != nullptr; }
+
+    void write(const GameRecord& game, const std::string& event) {
+        appendPdnGame(buffer, game, event);
+        if (buffer.size() >= FLUSH_BYTES) flush();
+    }
+
+    void flush() {
+        if (out && !buffer.empty()) {
+            ok = std::fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size() && ok;
+            buffer.clear();
+        }
+    }
+
+    bool close() {
+        if (!out) return ok;
+        flush();
+        ok = std::fclose(out) == 0 && ok;
+        out = nullptr;
+        return ok;
+    }
+};
+
+// --- 9. POSITION INDEX OVER GAME ARCHIVES ---
+
+const char INDEX_MAGIC[8] = {'C', 'K', 'I', 'N', 'D', 'X', '0', '1'};
+
+// On-disk layout: header, delta-coded postings, then the sorted key table
+struct IndexFileHeader {
+    char magic[8];
+    uint64_t gameCount;
+    uint64_t keyCount;
+    uint64_t keysOffset;
+};
+
+struct IndexKeyRecord {
+    uint64_t hash;
+    uint64_t postingsOffset; // File offset of this key's varint-coded game IDs
+    uint32_t postingCount;
+    uint32_t reserved;
+};
+
+// (position, game) pair; games are numbered per archive chunk until the chunk sizes are known
+struct IndexPosting {
+    uint64_t hash;
+    uint32_t chunk;
+    uint32_t game;
+};
+
+inline bool postingLess(const IndexPosting& a, const IndexPosting& b) {
+    if (a.hash != b.hash) return a.hash < b.hash;
+    if (a.chunk != b.chunk) return a.chunk < b.chunk;
+    return a.game < b.game;
+}
+
+inline void appendVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+/**
+ * @class PositionIndexBuilder
+ * @brief Builds the position -> games index from a PDN archive.
+ *
+ * The archive is split into chunks that are parsed in parallel; each worker records
+ * the hash of every position reached (the same Board state executeMove() leaves behind
+ * at the end of each turn) and spills sorted runs to disk whenever its buffer fills,
+ * so memory stays bounded for any archive size. The runs are then merged into one
+ * sorted key table with delta-compressed postings.
+ */
+class PositionIndexBuilder {
+private:
+    struct Collector {
+        std::vector<IndexPosting>* buffer;
+        PositionIndexBuilder* builder;
+        uint32_t chunk;
+        uint32_t game;
+
+        void beginGame(const Position& start) { add(start); }
+        void onMove(const Position&, const FullMove&, const Position& after) { add(after); }
+        void endGame(GameResult, bool) { ++game; }
+
+        void add(const Position& pos) {
+            IndexPosting posting = {hashPosition(pos), chunk, game};
+            buffer->push_back(posting);
+            if (buffer->size() >= builder->runPostings) builder->spillRun(*buffer);
+        }
+    };
+
+    std::string outputPath;
+    size_t runPostings; // Postings a worker buffers before spilling a sorted run
+    std::mutex runMutex;
+    std::vector<std::string> runPaths;
+
+    void spillRun(std::vector<IndexPosting>& buffer) {
+        std::sort(buffer.begin(), buffer.end(), postingLess);
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(runMutex);
+            path = outputPath + ".run" + std::to_string(runPaths.size());
+            runPaths.push_back(path);
+        }
+        FILE* out = std::fopen(path.c_str(), "wb");
+        if (!out || std::fwrite(buffer.data(), sizeof(IndexPosting), buffer.size(), out) != buffer.size()) {
+            std::cerr << "Could not write index run " << path << std::endl;
+            std::exit(1);
+        }
+        std::fclose(out);
+        buffer.clear();
+    }
+
+public:
+    PositionIndexBuilder(const std::string& path, size_t memoryMegabytes, int threads)
+        : outputPath(path),
+          runPostings(std::max<size_t>(1024, memoryMegabytes * 1024 * 1024 / sizeof(IndexPosting) / std::max(threads, 1))) {}
+
+    // Returns the number of indexed games, or -1 on failure
+    int64_t build(const MappedFile& archive, int threads) {
+        const char* text = (const char*)archive.data();
+        std::vector<const char*> bounds = splitPdnChunks(text, text + archive.size(), std::max(threads, 1));
+        size_t chunks = bounds.size() - 1;
+        std::vector<uint32_t> gamesPerChunk(chunks, 0);
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < chunks; ++i) {
+            workers.push_back(std::thread([this, &bounds, &gamesPerChunk, i]() {
+                std::vector<IndexPosting> buffer;
+                buffer.reserve(runPostings);
+                Collector collector = {&buffer, this, (uint32_t)i, 0};
+                PdnReader reader(bounds[i], bounds[i + 1]);
+                while (reader.readGame(collector)) {}
+                if (!buffer.empty()) spillRun(buffer);
+                gamesPerChunk[i] = collector.game;
+            }));
+        }
+        for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+
+        // Global game number = games in earlier chunks + number within the chunk
+        std::vector<uint64_t> chunkBase(chunks + 1, 0);
+        for (size_t i = 0; i < chunks; ++i) chunkBase[i + 1] = chunkBase[i] + gamesPerChunk[i];
+        bool ok = merge(chunkBase);
+        for (size_t i = 0; i < runPaths.size(); ++i) std::remove(runPaths[i].c_str());
+        return ok ? (int64_t)chunkBase[chunks] : -1;
+    }
+
+private:
+    // K-way merge of the sorted runs into the final index file
+    bool merge(const std::vector<uint64_t>& chunkBase) {
+        std::vector<std::unique_ptr<MappedFile> > runs;
+        std::vector<const IndexPosting*> heads, tails;
+        for (size_t i = 0; i < runPaths.size(); ++i) {
+            runs.push_back(std::unique_ptr<MappedFile>(new MappedFile()));
+            if (!runs.back()->open(runPaths[i])) return false;
+            const IndexPosting* first = (const IndexPosting*)runs.back()->data();
+            heads.push_back(first);
+            tails.push_back(first + runs.back()->size() / sizeof(IndexPosting));
+        }
+
+        FILE* out = std::fopen(outputPath.c_str(), "wb");
+        std::string keysPath = outputPath + ".keys";
+        FILE* keysOut = std::fopen(keysPath.c_str(), "wb+");
+        if (!out || !keysOut) {
+            if (out) std::fclose(out);
+            if (keysOut) std::fclose(keysOut);
+            return false;
+        }
+
+        IndexFileHeader header;
+        std::memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+        header.gameCount = chunkBase.back();
+        header.keyCount = 0;
+        bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+        uint64_t offset = sizeof(header);
+
+        // Min-heap of run indices ordered by their current head posting
+        std::vector<size_t> heap;
+        for (size_t i = 0; i < heads.size(); ++i) {
+            if (heads[i] < tails[i]) heap.push_back(i);
+        }
+        auto later = [&heads](size_t a, size_t b) { return postingLess(*heads[b], *heads[a]); };
+        std::make_heap(heap.begin(), heap.end(), later);
+
+        std::vector<uint8_t> postings;
+        IndexKeyRecord key = {0, 0, 0, 0};
+        uint64_t lastGame = 0;
+        bool haveKey = false;
+        while (ok && !heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            size_t run = heap.back();
+            IndexPosting posting = *heads[run]++;
+            if (heads[run] < tails[run]) std::push_heap(heap.begin(), heap.end(), later);
+            else heap.pop_back();
+
+            uint64_t game = chunkBase[posting.chunk] + posting.game;
+            if (!haveKey || posting.hash != key.hash) {
+                if (haveKey) {
+                    ok = std::fwrite(&key, sizeof(key), 1, keysOut) == 1;
+                    header.keyCount++;
+                }
+                key.hash = posting.hash;
+                key.postingsOffset = offset + postings.size();
+                key.postingCount = 0;
+                haveKey = true;
+            } else if (game == lastGame) {
+                continue; // Position repeated within the same game
+            }
+            appendVarint(postings, (uint32_t)(key.postingCount == 0 ? game : game - lastGame));
+            key.postingCount++;
+            lastGame = game;
+
+            if (postings.size() >= (1 << 20)) {
+                ok = ok && std::fwrite(postings.data(), 1, postings.size(), out) == postings.size();
+                offset += postings.size();
+                postings.clear();
+            }
+        }
+        if (haveKey) {
+            ok = ok && std::fwrite(&key, sizeof(key), 1, keysOut) == 1;
+            header.keyCount++;
+        }
+        ok = ok && std::fwrite(postings.data(), 1, postings.size(), out) == postings.size();
+        offset += postings.size();
+
+        // Append the key table (8-byte aligned) and patch the header
+        static const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        size_t pad = (size_t)((8 - offset % 8) % 8);
+        ok = ok && std::fwrite(padding, 1, pad, out) == pad;
+        header.keysOffset = offset + pad;
+        std::rewind(keysOut);
+        char copy[1 << 16];
+        size_t n;
+        while (ok && (n = std::fread(copy, 1, sizeof(copy), keysOut)) > 0) {
+            ok = std::fwrite(copy, 1, n, out) == n;
+        }
+        std::fclose(keysOut);
+        std::remove(keysPath.c_str());
+        ok = ok && std::fseek(out, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, out) == 1;
+        return std::fclose(out) == 0 && ok;
+    }
+};
+
+/**
+ * @class PositionIndex
+ * @brief Memory-mapped position index: a binary search over the key table
+ * followed by decoding one postings list.
+ */
+class PositionIndex {
+private:
+    MappedFile file;
+    IndexFileHeader header;
+    const IndexKeyRecord* keys;
+
+public:
+    PositionIndex() : keys(nullptr) {}
+
+    bool open(const std::string& path) {
+        if (!file.open(path) || file.size() < sizeof(IndexFileHeader)) return false;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0 || header.keysOffset > file.size() ||
+            header.keyCount > (file.size() - header.keysOffset) / sizeof(IndexKeyRecord)) {
+            file.close();
+            return false;
+        }
+        keys = (const IndexKeyRecord*)(file.data() + header.keysOffset);
+        return true;
+    }
+
+    uint64_t gameCount() const { return header.gameCount; }
+    uint64_t positionCount() const { return header.keyCount; }
+
+    // Appends the IDs (archive order, 0-based) of every game that reached 'pos'; false
+    // if its postings list runs past the end of the file or holds a malformed varint
+    bool gamesReaching(const Position& pos, std::vector<uint64_t>& games) const {
+        uint64_t hash = hashPosition(pos);
+        const IndexKeyRecord* end = keys + header.keyCount;
+        const IndexKeyRecord* it = std::lower_bound(keys, end, hash, [](const IndexKeyRecord& k, uint64_t h) {
+            return k.hash < h;
+        });
+        if (it == end || it->hash != hash) return true;
+        if (it->postingsOffset >= file.size()) return false;
+
+        const uint8_t* p = file.data() + it->postingsOffset;
+        const uint8_t* limit = file.data() + file.size();
+        uint64_t game = 0;
+        for (uint32_t i = 0; i < it->postingCount; ++i) {
+            uint32_t delta = 0;
+            int shift = 0;
+            while (true) {
+                if (p == limit || shift > 28) return false; // Truncated, or longer than 5 bytes
+                uint8_t byte = *p++;
+                delta |= (uint32_t)(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) break;
+                shift += 7;
+            }
+            game = (i == 0) ? delta : game + delta;
+            games.push_back(game);
+        }
+        return true;
+    }
+};
+
+// --- 10. OPENING BOOK ---
+
+const char BOOK_MAGIC[8] = {'C', 'K', 'B', 'O', 'O', 'K', '0', '1'};
+
+// Fixed-size book entry; the file holds these sorted by (key, from, to)
+struct BookRecord {
+    uint64_t key;     // hashPosition() of the position before the move
+    uint8_t from;
+    uint8_t to;
+    uint16_t reserved;
+    uint32_t wins;    // Results from the point of view of the side that played the move
+    uint32_t draws;
+    uint32_t losses;
+};
+
+struct BookFileHeader {
+    char magic[8];
+    uint64_t recordCount;
+};
+
+/**
+ * @class OpeningBook
+ * @brief Memory-mapped opening book. Opening only maps the file and a probe is a
+ * binary search over the records, so neither depends on the size of the book.
+ */
+class OpeningBook {
+private:
+    MappedFile file;
+    const BookRecord* records;
+    uint64_t recordCount;
+
+public:
+    OpeningBook() : records(nullptr), recordCount(0) {}
+
+    bool open(const std::string& path) {
+        if (!file.open(path) || file.size() < sizeof(BookFileHeader)) return false;
+        BookFileHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, BOOK_MAGIC, sizeof(header.magic)) != 0 ||
+            sizeof(header) + header.recordCount * sizeof(BookRecord) > file.size()) {
+            file.close();
+            return false;
+        }
+        records = (const BookRecord*)(file.data() + sizeof(header));
+        recordCount = header.recordCount;
+        return true;
+    }
+
+    bool isOpen() const { return file.isOpen(); }
+    uint64_t size() const { return recordCount; }
+
+    // Picks the book move with the best expected score; returns false when the
+    // position is not in the book or its book move is not legal here
+    bool probe(const Position& pos, FullMove& move) const {
+        if (!records) return false;
+        uint64_t key = hashPosition(pos);
+        const BookRecord* end = records + recordCount;
+        const BookRecord* it = std::lower_bound(records, end, key, [](const BookRecord& r, uint64_t k) {
+            return r.key < k;
+        });
+
+        const BookRecord* best = nullptr;
+        double bestScore = -1.0;
+        for (; it != end && it->key == key; ++it) {
+            double games = (double)it->wins + it->draws + it->losses;
+            double score = (it->wins + 0.5 * it->draws + 1.0) / (games + 2.0); // Laplace-smoothed
+            if (score > bestScore) {
+                bestScore = score;
+                best = it;
+            }
+        }
+        if (!best) return false;
+
+        MoveList moves;
+        generateMoves(pos, moves);
+        for (int i = 0; i < moves.count; ++i) {
+            if (moves.moves[i].from == best->from && moves.moves[i].to == best->to) {
+                move = moves.moves[i];
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// --- 11. SEARCH ENGINE ---
+
+const int MAX_PLY = 128;
+const int INFINITE_SCORE = 32000;
+const int WIN_SCORE = 30000;    // Win in N plies scores WIN_SCORE - N
+const int TB_WIN_SCORE = 20000; // Tablebase win, distance unknown
+const int MAN_VALUE = 100;
+const int KING_VALUE = 150;
+
+/**
+ * @struct SearchLimits
+ * @brief Stopping conditions for a search; zero means "no limit".
+ */
+struct SearchLimits {
+    int maxDepth;
+    uint64_t maxNodes;
+    int64_t moveTimeMs;
+    bool infinite; // Search until stopped, ignoring any default budget
+
+    SearchLimits() : maxDepth(0), maxNodes(0), moveTimeMs(0), infinite(false) {}
+};
+
+/**
+ * @struct SearchResult
+ * @brief Best move found, its score from the mover's point of view and the PV.
+ */
+struct SearchResult {
+    bool hasMove;
+    bool fromBook;
+    FullMove bestMove;
+    int score;
+    int depth;
+    uint64_t nodes;
+    int64_t timeMs;
+    std::vector<FullMove> pv;
+
+    SearchResult() : hasMove(false), fromBook(false), score(0), depth(0), nodes(0), timeMs(0) {}
+};
+
+// Small fast generator for randomized openings and playouts (xorshift64*)
+struct RandomGenerator {
+    uint64_t state;
+
+    explicit RandomGenerator(uint64_t seed) : state(seed ? seed : 0x2545F4914F6CDD1Dull) {}
+
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    int below(int n) { return (int)(next() % (uint64_t)n); }
+};
+
+/**
+ * @class MctsSearcher
+ * @brief Parallel UCT Monte Carlo tree search with random playouts.
+ *
+ * All threads share one tree. Nodes come from a pool allocated once up front, and their
+ * statistics are atomics, so the tree is searched without locks. A thread descending
+ * through a node adds a virtual loss to it, which steers the other threads elsewhere
+ * until the real result is backed up. Playouts pick uniformly among the legal moves of
+ * generateMoves(), so no evaluation function is needed.
+ */
+class MctsSearcher {
+private:
+    static const uint32_t VIRTUAL_LOSS = 3;
+    static const int PLAYOUT_PLIES = 150;       // Longer playouts are scored as draws
+    static const uint64_t DEFAULT_PLAYOUTS = 20000; // When the limits give no node or time budget
+    enum NodeState { UNEXPANDED = 0, EXPANDING = 1, EXPANDED = 2, FULL = 3 }; // FULL: no room left for children
+
+    struct Node {
+        FullMove move;                  // Move that leads to this node
+        std::atomic<uint32_t> visits;   // Includes virtual losses still in flight
+        std::atomic<uint32_t> score;    // Half-points won by the side that played 'move'
+        std::atomic<uint32_t> firstChild;
+        std::atomic<uint32_t> childCount;
+        std::atomic<uint8_t> state;
+    };
+
+    int threadCount;
+    size_t capacity;
+    std::unique_ptr<Node[]> pool;
+    std::atomic<uint32_t> nodeCount;
+    std::atomic<uint64_t> playouts;
+    std::atomic<bool> finished;
+    Position rootPosition;
+    SearchLimits limits;
+    uint64_t playoutBudget;
+    std::chrono::steady_clock::time_point startTime;
+    const std::atomic<bool>* stopRequested;
+
+    void initNode(Node& node, const FullMove& move) {
+        node.move = move;
+        node.visits.store(0, std::memory_order_relaxed);
+        node.score.store(0, std::memory_order_relaxed);
+        node.firstChild.store(0, std::memory_order_relaxed);
+        node.childCount.store(0, std::memory_order_relaxed);
+        node.state.store(UNEXPANDED, std::memory_order_relaxed);
+    }
+
+    // Claims the node and gives it one child per legal move; only one thread succeeds.
+    // The pool space is reserved with a compare-and-swap so the counter never passes
+    // 'capacity'; once the pool is full the node stays a leaf for good.
+    void expand(Node& node, const MoveList& moves) {
+        uint8_t expected = UNEXPANDED;
+        if (!node.state.compare_exchange_strong(expected, EXPANDING)) return;
+        uint32_t first = nodeCount.load();
+        do {
+            if (first + (size_t)moves.count > capacity) {
+                node.state.store(FULL);
+                return;
+            }
+        } while (!nodeCount.compare_exchange_weak(first, first + (uint32_t)moves.count));
+        for (int i = 0; i < moves.count; ++i) initNode(pool[first + i], moves.moves[i]);
+        node.firstChild.store(first, std::memory_order_relaxed);
+        node.childCount.store((uint32_t)moves.count, std::memory_order_relaxed);
+        node.state.store(EXPANDED, std::memory_order_release);
+    }
+
+    Node& selectChild(const Node& node) {
+        uint32_t first = node.firstChild.load(std::memory_order_relaxed);
+        uint32_t count = node.childCount.load(std::memory_order_relaxed);
+        double logParent = std::log((double)std::max<uint32_t>(1, node.visits.load(std::memory_order_relaxed)));
+        uint32_t best = first;
+        double bestValue = -1.0;
+        for (uint32_t i = first; i < first + count; ++i) {
+            uint32_t visits = pool[i].visits.load(std::memory_order_relaxed);
+            if (visits == 0) return pool[i]; // Try every move once
+            double value = pool[i].score.load(std::memory_order_relaxed) / (2.0 * visits) +
+                           1.4 * std::sqrt(logParent / visits);
+            if (value > bestValue) {
+                bestValue = value;
+                best = i;
+            }
+        }
+        return pool[best];
+    }
+
+    // Plays random legal moves to the end; returns the winner, or NONE for a draw
+    static Player playout(Position pos, RandomGenerator& rng) {
+        MoveList moves;
+        for (int ply = 0; ply < PLAYOUT_PLIES; ++ply) {
+            if (generateMoves(pos, moves) == 0) return opponentOf(pos.sideToMove);
+            pos = applyMove(pos, moves.moves[rng.below(moves.count)]);
+        }
+        return NONE;
+    }
+
+    bool outOfBudget() {
+        if (finished.load(std::memory_order_relaxed)) return true;
+        bool done = (stopRequested && stopRequested->load(std::memory_order_relaxed)) ||
+                    playouts.load(std::memory_order_relaxed) >= playoutBudget ||
+                    (limits.moveTimeMs && !limits.infinite && std::chrono::duration_cast<std::chrono::milliseconds>(
+                                              std::chrono::steady_clock::now() - startTime).count() >= limits.moveTimeMs);
+        if (done) finished.store(true);
+        return done;
+    }
+
+    void worker(uint64_t seed) {
+        RandomGenerator rng(seed);
+        Node* path[MAX_PLY];
+        Player movers[MAX_PLY]; // Side that played the move into path[i]
+        while (!outOfBudget()) {
+            Position pos = rootPosition;
+            Node* node = &pool[0];
+            int length = 0;
+            node->visits.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+            path[length] = node;
+            movers[length++] = opponentOf(pos.sideToMove);
+
+            // Selection: follow UCT through expanded nodes, marking the path with virtual losses
+            while (length < MAX_PLY && node->state.load(std::memory_order_acquire) == EXPANDED) {
+                node = &selectChild(*node);
+                node->visits.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+                path[length] = node;
+                movers[length++] = pos.sideToMove;
+                pos = applyMove(pos, node->move);
+            }
+
+            // Expansion and simulation
+            MoveList moves;
+            Player winner;
+            if (generateMoves(pos, moves) == 0) {
+                winner = opponentOf(pos.sideToMove);
+            } else {
+                if (node->visits.load(std::memory_order_relaxed) > VIRTUAL_LOSS) expand(*node, moves);
+                winner = playout(pos, rng);
+            }
+
+            // Backpropagation replaces each virtual loss with the real result
+            for (int i = 0; i < length; ++i) {
+                path[i]->visits.fetch_sub(VIRTUAL_LOSS - 1, std::memory_order_relaxed);
+                uint32_t points = (winner == NONE) ? 1 : (winner == movers[i]) ? 2 : 0;
+                if (points) path[i]->score.fetch_add(points, std::memory_order_relaxed);
+            }
+            playouts.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    const Node* mostVisitedChild(const Node& node) const {
+        if (node.state.load(std::memory_order_acquire) != EXPANDED) return nullptr;
+        const Node* best = nullptr;
+        uint32_t first = node.firstChild.load(std::memory_order_relaxed);
+        for (uint32_t i = first; i < first + node.childCount.load(std::memory_order_relaxed); ++i) {
+            if (!best || pool[i].visits.load() > best->visits.load()) best = &pool[i];
+        }
+        return best;
+    }
+
+public:
+    MctsSearcher(int threads, int memoryMegabytes)
+        : threadCount(std::max(1, threads)),
+          capacity(std::min<size_t>(UINT32_MAX, std::max<size_t>(1024, (size_t)memoryMegabytes * 1024 * 1024 / sizeof(Node)))),
+          pool(new Node[capacity]), nodeCount(0), playouts(0), finished(false), rootPosition(initialPosition()),
+          playoutBudget(0), stopRequested(nullptr) {}
+
+    // Searches until the node (playout) or time limit, or until 'stop' becomes true.
+    // Depth limits do not apply; without any other limit DEFAULT_PLAYOUTS are run. An
+    // infinite search ignores node and time limits and runs until 'stop'.
+    SearchResult think(const Position& pos, const SearchLimits& searchLimits, const std::atomic<bool>* stop) {
+        rootPosition = pos;
+        limits = searchLimits;
+        playoutBudget = limits.infinite ? UINT64_MAX
+                        : limits.maxNodes ? limits.maxNodes
+                        : limits.moveTimeMs ? UINT64_MAX : DEFAULT_PLAYOUTS;
+        stopRequested = stop;
+        startTime = std::chrono::steady_clock::now();
+        playouts.store(0);
+        finished.store(false);
+        nodeCount.store(1);
+        FullMove none = FullMove();
+        initNode(pool[0], none);
+        MoveList moves;
+        generateMoves(pos, moves);
+        pool[0].visits.store(VIRTUAL_LOSS + 1); // Expand the root right away
+        expand(pool[0], moves);
+
+        std::vector<std::thread> helpers;
+        for (int t = 1; t < threadCount; ++t) {
+            helpers.emplace_back(&MctsSearcher::worker, this, 0x9E3779B97F4A7C15ull * (uint64_t)t);
+        }
+        worker(0x2545F4914F6CDD1Dull);
+        for (size_t t = 0; t < helpers.size(); ++t) helpers[t].join();
+
+        SearchResult result;
+        result.nodes = playouts.load();
+        for (const Node* node = mostVisitedChild(pool[0]); node && node->visits.load() > 0 && result.pv.size() < MAX_PLY;
+             node = mostVisitedChild(*node)) {
+            result.pv.push_back(node->move);
+        }
+        if (result.pv.empty()) return result;
+        const Node* best = mostVisitedChild(pool[0]);
+        double winRate = best->score.load() / (2.0 * std::max<uint32_t>(1, best->visits.load()));
+        result.hasMove = true;
+        result.bestMove = result.pv[0];
+        result.score = (int)std::lround((2.0 * winRate - 1.0) * 1000.0); // +-1000 for certain wins and losses
+        result.depth = (int)result.pv.size();
+        return result;
+    }
+
+    size_t nodesUsed() const { return nodeCount.load(); }
+};
+
+// Evaluation terms, in the same units as MAN_VALUE and KING_VALUE
+const int BACK_RANK_BONUS = 10;   // Man still guarding its own back row
+const int CENTER_MAN_BONUS = 6;   // Man on one of the eight central squares
+const int CENTER_KING_BONUS = 10; // King on one of the eight central squares
+const int COHESION_BONUS = 4;     // Two pieces of one colour defending each other diagonally
+
+const int EVAL_REGIONS = 8;         // Two rows by half the board width, four squares each
+const int EVAL_PATTERNS = 625;      // 5^4 contents of a region (SquareType per square)
+const int REGION_POWERS[4] = {1, 5, 25, 125};
+const char EVAL_MAGIC[8] = {'C', 'K', 'E', 'V', 'A', 'L', '0', '1'};
+
+/**
+ * @struct Evaluation
+ * @brief Incrementally maintained evaluation state of one position.
+ *
+ * 'material' sums the piece-square values (material, back rank, center and advancement)
+ * from RED's point of view; 'patterns' holds the base-5 pattern index of every region.
+ */
+struct Evaluation {
+    int material;
+    uint16_t patterns[EVAL_REGIONS];
+};
+
+/**
+ * @class Evaluator
+ * @brief Piece-square and region-pattern evaluation with incremental updates.
+ *
+ * Every square belongs to one region and has a fixed slot in it, so a square changing
+ * from one SquareType to another moves that region's pattern index by a precomputed
+ * step. update() therefore only touches the squares a move changes (origin, landing
+ * square and captures) instead of rescanning the board.
+ *
+ * The tables are linear weights over sparse features (see features()), which is what
+ * EvaluationTuner fits; tuned weights are saved and loaded as EVAL_MAGIC files.
+ */
+class Evaluator {
+private:
+    uint8_t regionOf[NUM_SQUARES];
+    uint8_t slotOf[NUM_SQUARES];
+    int16_t pieceSquare[5][NUM_SQUARES];             // Indexed by SquareType, RED's point of view
+    int16_t patternWeights[EVAL_REGIONS][EVAL_PATTERNS];
+
+    static bool isCenter(int sq) {
+        int r = squareRow(sq), c = squareCol(sq);
+        return r >= 2 && r <= 5 && c >= 2 && c <= 5;
+    }
+
+    static int squareType(const Position& pos, int sq) {
+        uint32_t bit = 1u << sq;
+        bool king = (pos.kings & bit) != 0;
+        if (pos.red & bit) return king ? RED_KING : RED_PIECE;
+        if (pos.black & bit) return king ? BLACK_KING : BLACK_PIECE;
+        return EMPTY;
+    }
+
+    // Changes one square's contents in 'eval'
+    void changeSquare(Evaluation& eval, int sq, int from, int to) const {
+        eval.material += pieceSquare[to][sq] - pieceSquare[from][sq];
+        eval.patterns[regionOf[sq]] = (uint16_t)(eval.patterns[regionOf[sq]] + (to - from) * REGION_POWERS[slotOf[sq]]);
+    }
+
+public:
+    Evaluator() {
+        int filled[EVAL_REGIONS] = {0};
+        int members[EVAL_REGIONS][4];
+        for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+            int region = (squareRow(sq) / 2) * 2 + (squareCol(sq) >= BOARD_SIZE / 2 ? 1 : 0);
+            regionOf[sq] = (uint8_t)region;
+            slotOf[sq] = (uint8_t)filled[region];
+            members[region][filled[region]++] = sq;
+        }
+
+        // RED's tables; BLACK's are the same board turned round with the sign flipped
+        for (int sq = 0; sq < NUM_SQUARES; ++sq) {
+            int row = squareRow(sq);
+            int man = MAN_VALUE + (BOARD_SIZE - 1 - row) + (row == BOARD_SIZE - 1 ? BACK_RANK_BONUS : 0) +
+                      (isCenter(sq) ? CENTER_MAN_BONUS : 0);
+            int king = KING_VALUE + (isCenter(sq) ? CENTER_KING_BONUS : 0);
+            pieceSquare[EMPTY][sq] = 0;
+            pieceSquare[RED_PIECE][sq] = (int16_t)man;
+            pieceSquare[RED_KING][sq] = (int16_t)king;
+            pieceSquare[BLACK_PIECE][NUM_SQUARES - 1 - sq] = (int16_t)-man;
+            pieceSquare[BLACK_KING][NUM_SQUARES - 1 - sq] = (int16_t)-king;
+        }
+
+        // Pattern weights: reward diagonal neighbours of one colour inside each region
+        for (int region = 0; region < EVAL_REGIONS; ++region) {
+            for (int pattern = 0; pattern < EVAL_PATTERNS; ++pattern) {
+                int types[4];
+                for (int slot = 0, rest = pattern; slot < 4; ++slot, rest /= 5) types[slot] = rest % 5;
+                int weight = 0;
+                for (int a = 0; a < 4; ++a) {
+                    for (int b = a + 1; b < 4; ++b) {
+                        bool adjacent = false;
+                        for (int d = 0; d < 4; ++d) adjacent |= SQUARE_TABLES.step[members[region][a]][d] == members[region][b];
+                        if (!adjacent) continue;
+                        bool redA = types[a] == RED_PIECE || types[a] == RED_KING;
+                        bool redB = types[b] == RED_PIECE || types[b] == RED_KING;
+                        bool blackA = types[a] == BLACK_PIECE || types[a] == BLACK_KING;
+                        bool blackB = types[b] == BLACK_PIECE || types[b] == BLACK_KING;
+                        if (redA && redB) weight += COHESION_BONUS;
+                        if (blackA && blackB) weight -= COHESION_BONUS;
+                    }
+                }
+                patternWeights[region][pattern] = (int16_t)weight;
+            }
+        }
+    }
+
+    // Builds the evaluation state from scratch
+    Evaluation compute(const Position& pos) const {
+        Evaluation eval;
+        eval.material = 0;
+        for (int region = 0; region < EVAL_REGIONS; ++region) eval.patterns[region] = 0;
+        for (uint32_t bits = pos.occupied(); bits; bits &= bits - 1) {
+            int sq = lowestSquare(bits);
+            changeSquare(eval, sq, EMPTY, squareType(pos, sq));
+        }
+        return eval;
+    }
+
+    // Evaluation state after 'move' is played in 'pos', derived from the state of 'pos'
+    Evaluation update(const Evaluation& eval, const Position& pos, const FullMove& move) const {
+        Evaluation next = eval;
+        int piece = squareType(pos, move.from);
+        int landed = piece;
+        uint32_t crownRow = (pos.sideToMove == RED) ? RED_CROWN_ROW : BLACK_CROWN_ROW;
+        if ((crownRow >> move.to) & 1u) landed = (pos.sideToMove == RED) ? RED_KING : BLACK_KING;
+        changeSquare(next, move.from, piece, EMPTY);
+        changeSquare(next, move.to, EMPTY, landed);
+        for (uint32_t bits = move.captures; bits; bits &= bits - 1) {
+            int sq = lowestSquare(bits);
+            changeSquare(next, sq, squareType(pos, sq), EMPTY);
+        }
+        return next;
+    }
+
+    // Tunable weights: the piece-square values of the four piece types followed by every
+    // region's pattern table. The evaluation from RED's point of view is the plain sum of
+    // the weights of a position's active features.
+    static const int PIECE_PARAMETERS = 4 * NUM_SQUARES;
+    static const int PARAMETERS = PIECE_PARAMETERS + EVAL_REGIONS * EVAL_PATTERNS;
+
+    // Writes the indices of the active features of 'pos' and returns how many there are
+    // (at most NUM_SQUARES + EVAL_REGIONS)
+    int features(const Position& pos, int* indices) const {
+        int count = 0;
+        uint16_t patterns[EVAL_REGIONS] = {0};
+        for (uint32_t bits = pos.occupied(); bits; bits &= bits - 1) {
+            int sq = lowestSquare(bits);
+            int type = squareType(pos, sq);
+            indices[count++] = (type - 1) * NUM_SQUARES + sq;
+            patterns[regionOf[sq]] = (uint16_t)(patterns[regionOf[sq]] + type * REGION_POWERS[slotOf[sq]]);
+        }
+        for (int region = 0; region < EVAL_REGIONS; ++region) {
+            indices[count++] = PIECE_PARAMETERS + region * EVAL_PATTERNS + patterns[region];
+        }
+        return count;
+    }
+
+    void getParameters(std::vector<double>& weights) const {
+        weights.resize(PARAMETERS);
+        for (int type = 1; type < 5; ++type) {
+            for (int sq = 0; sq < NUM_SQUARES; ++sq) weights[(type - 1) * NUM_SQUARES + sq] = pieceSquare[type][sq];
+        }
+        for (int region = 0; region < EVAL_REGIONS; ++region) {
+            for (int pattern = 0; pattern < EVAL_PATTERNS; ++pattern) {
+                weights[PIECE_PARAMETERS + region * EVAL_PATTERNS + pattern] = patternWeights[region][pattern];
+            }
+        }
+    }
+
+    // Rounds tuned weights back into the integer tables
+    void setParameters(const std::vector<double>& weights) {
+        for (int i = 0; i < PARAMETERS; ++i) {
+            double clamped = std::min(32767.0, std::max(-32767.0, weights[i]));
+            int16_t value = (int16_t)std::lround(clamped);
+            if (i < PIECE_PARAMETERS) pieceSquare[i / NUM_SQUARES + 1][i % NUM_SQUARES] = value;
+            else patternWeights[(i - PIECE_PARAMETERS) / EVAL_PATTERNS][(i - PIECE_PARAMETERS) % EVAL_PATTERNS] = value;
+        }
+    }
+
+    // Weight files are EVAL_MAGIC followed by the PARAMETERS int16 weights (little-endian)
+    bool load(const std::string& path) {
+        MappedFile file;
+        if (!file.open(path) || file.size() != sizeof(EVAL_MAGIC) + PARAMETERS * sizeof(int16_t) ||
+            std::memcmp(file.data(), EVAL_MAGIC, sizeof(EVAL_MAGIC)) != 0) {
+            return false;
+        }
+        std::vector<double> weights(PARAMETERS);
+        for (int i = 0; i < PARAMETERS; ++i) {
+            int16_t value;
+            std::memcpy(&value, file.data() + sizeof(EVAL_MAGIC) + i * sizeof(int16_t), sizeof(value));
+            weights[i] = value;
+        }
+        setParameters(weights);
+        return true;
+    }
+
+    bool save(const std::string& path) const {
+        std::vector<double> weights;
+        getParameters(weights);
+        std::vector<int16_t> values(weights.begin(), weights.end());
+        std::ofstream out(path.c_str(), std::ios::binary);
+        out.write(EVAL_MAGIC, sizeof(EVAL_MAGIC));
+        out.write((const char*)values.data(), values.size() * sizeof(int16_t));
+        return (bool)out;
+    }
+
+    // Score from the point of view of 'side'
+    int score(const Evaluation& eval, Player side) const {
+        int total = eval.material;
+        for (int region = 0; region < EVAL_REGIONS; ++region) total += patternWeights[region][eval.patterns[region]];
+        return (side == RED) ? total : -total;
+    }
+
+    int evaluate(const Position& pos) const {
+        return score(compute(pos), pos.sideToMove);
+    }
+};
+
+const Evaluator DEFAULT_EVALUATOR;
+
+// Efficiently updatable network: 128 piece-square features per perspective feed a 64-wide
+// int16 accumulator; both perspectives (side to move first) are clipped to [0, 127] and
+// go through a 128 -> 16 int8 layer and a 16 -> 1 int8 output.
+const int NNUE_FEATURES = 4 * NUM_SQUARES; // Own man, own king, enemy man, enemy king on each square
+const int NNUE_HIDDEN = 64;
+const int NNUE_INPUTS = 2 * NNUE_HIDDEN;
+const int NNUE_LAYER = 16;
+const int NNUE_LAYER_SHIFT = 6; // Layer sums are divided by 64 before clipping
+const int NNUE_ACTIVATION_MAX = 127;
+const char NNUE_MAGIC[8] = {'C', 'K', 'N', 'N', 'U', 'E', '0', '1'};
+
+/**
+ * @struct Accumulator
+ * @brief First-layer sums of one position from RED's and BLACK's perspective.
+ */
+struct alignas(32) Accumulator {
+    int16_t values[2][NNUE_HIDDEN]; // [0] = RED, [1] = BLACK
+};
+
+/**
+ * @class Network
+ * @brief Quantized CPU network evaluator with incremental accumulator updates.
+ *
+ * A move only adds or removes the features of the squares it touches (origin, landing
+ * square, captures and the promotion), so update() costs a few vector additions instead
+ * of the 128 x 64 products of refresh(). The dense layers use AVX2 when the build enables
+ * it (-mavx2) and plain integer code otherwise; both give identical results.
+ *
+ * Until trained weights are loaded the network is initialised to count material with
+ * MAN_VALUE and KING_VALUE. The weight file is NNUE_MAGIC followed by the weight arrays
+ * in declaration order (little-endian).
+ */
+class Network {
+private:
+    alignas(32) int16_t featureWeights[NNUE_FEATURES][NNUE_HIDDEN];
+    alignas(32) int16_t featureBias[NNUE_HIDDEN];
+    alignas(32) int8_t layerWeights[NNUE_LAYER][NNUE_INPUTS];
+    int32_t layerBias[NNUE_LAYER];
+    int8_t outputWeights[NNUE_LAYER];
+    int32_t outputBias;
+
+    // Feature of a piece seen from one perspective; BLACK sees the board turned round
+    static int featureOf(int perspective, bool redPiece, bool king, int sq) {
+        bool own = redPiece == (perspective == 0);
+        int square = perspective == 0 ? sq : NUM_SQUARES - 1 - sq;
+        return ((own ? 0 : 2) + (king ? 1 : 0)) * NUM_SQUARES + square;
+    }
+
+    static void addWeights(int16_t* values, const int16_t* weights) {
+#if defined(__AVX2__)
+        for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+            __m256i sum = _mm256_add_epi16(_mm256_load_si256((const __m256i*)(values + i)),
+                                           _mm256_load_si256((const __m256i*)(weights + i)));
+            _mm256_store_si256((__m256i*)(values + i), sum);
+        }
+#else
+        for (int i = 0; i < NNUE_HIDDEN; ++i) values[i] = (int16_t)(values[i] + weights[i]);
+#endif
+    }
+
+    static void subtractWeights(int16_t* values, const int16_t* weights) {
+#if defined(__AVX2__)
+        for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+            __m256i difference = _mm256_sub_epi16(_mm256_load_si256((const __m256i*)(values + i)),
+                                                  _mm256_load_si256((const __m256i*)(weights + i)));
+            _mm256_store_si256((__m256i*)(values + i), difference);
+        }
+#else
+        for (int i = 0; i < NNUE_HIDDEN; ++i) values[i] = (int16_t)(values[i] - weights[i]);
+#endif
+    }
+
+    void addPiece(Accumulator& acc, bool redPiece, bool king, int sq) const {
+        for (int p = 0; p < 2; ++p) addWeights(acc.values[p], featureWeights[featureOf(p, redPiece, king, sq)]);
+    }
+
+    void removePiece(Accumulator& acc, bool redPiece, bool king, int sq) const {
+        for (int p = 0; p < 2; ++p) subtractWeights(acc.values[p], featureWeights[featureOf(p, redPiece, king, sq)]);
+    }
+
+    static uint8_t clip(int value) {
+        return (uint8_t)std::min(std::max(value, 0), NNUE_ACTIVATION_MAX);
+    }
+
+    int output(const uint8_t* hidden) const {
+        int sum = outputBias;
+        for (int o = 0; o < NNUE_LAYER; ++o) sum += hidden[o] * outputWeights[o];
+        return sum;
+    }
+
+public:
+    Network() {
+        // Material counter: four hidden units count own/enemy men/kings (10 per piece)
+        std::memset(featureWeights, 0, sizeof(featureWeights));
+        std::memset(featureBias, 0, sizeof(featureBias));
+        std::memset(layerWeights, 0, sizeof(layerWeights));
+        std::memset(layerBias, 0, sizeof(layerBias));
+        for (int kind = 0; kind < 4; ++kind) {
+            for (int sq = 0; sq < NUM_SQUARES; ++sq) featureWeights[kind * NUM_SQUARES + sq][kind] = 10;
+            layerWeights[kind][kind] = 1 << NNUE_LAYER_SHIFT; // Pass the count through unchanged
+        }
+        const int8_t values[4] = {MAN_VALUE / 10, KING_VALUE / 10, -MAN_VALUE / 10, -KING_VALUE / 10};
+        std::memset(outputWeights, 0, sizeof(outputWeights));
+        std::memcpy(outputWeights, values, sizeof(values));
+        outputBias = 0;
+    }
+
+    bool load(const std::string& path) {
+        MappedFile file;
+        size_t payload = sizeof(featureWeights) + sizeof(featureBias) + sizeof(layerWeights) + sizeof(layerBias) +
+                         sizeof(outputWeights) + sizeof(outputBias);
+        if (!file.open(path) || file.size() != sizeof(NNUE_MAGIC) + payload ||
+            std::memcmp(file.data(), NNUE_MAGIC, sizeof(NNUE_MAGIC)) != 0) {
+            return false;
+        }
+        const uint8_t* p = file.data() + sizeof(NNUE_MAGIC);
+        std::memcpy(featureWeights, p, sizeof(featureWeights));
+        p += sizeof(featureWeights);
+        std::memcpy(featureBias, p, sizeof(featureBias));
+        p += sizeof(featureBias);
+        std::memcpy(layerWeights, p, sizeof(layerWeights));
+        p += sizeof(layerWeights);
+        std::memcpy(layerBias, p, sizeof(layerBias));
+        p += sizeof(layerBias);
+        std::memcpy(outputWeights, p, sizeof(outputWeights));
+        p += sizeof(outputWeights);
+        std::memcpy(&outputBias, p, sizeof(outputBias));
+        return true;
+    }
+
+    bool save(const std::string& path) const {
+        std::ofstream out(path.c_str(), std::ios::binary);
+        out.write(NNUE_MAGIC, sizeof(NNUE_MAGIC));
+        out.write((const char*)featureWeights, sizeof(featureWeights));
+        out.write((const char*)featureBias, sizeof(featureBias));
+        out.write((const char*)layerWeights, sizeof(layerWeights));
+        out.write((const char*)layerBias, sizeof(layerBias));
+        out.write((const char*)outputWeights, sizeof(outputWeights));
+        out.write((const char*)&outputBias, sizeof(outputBias));
+        return (bool)out;
+    }
+
+    // Builds both accumulators from scratch
+    void refresh(const Position& pos, Accumulator& acc) const {
+        for (int p = 0; p < 2; ++p) std::memcpy(acc.values[p], featureBias, sizeof(featureBias));
+        for (uint32_t bits = pos.occupied(); bits; bits &= bits - 1) {
+            int sq = lowestSquare(bits);
+            addPiece(acc, (pos.red >> sq) & 1u, (pos.kings >> sq) & 1u, sq);
+        }
+    }
+
+    // Accumulators after 'move' is played in 'pos', derived from those of 'pos'
+    void update(const Accumulator& parent, const Position& pos, const FullMove& move, Accumulator& child) const {
+        child = parent;
+        bool red = pos.sideToMove == RED;
+        bool king = (pos.kings >> move.from) & 1u;
+        uint32_t crownRow = red ? RED_CROWN_ROW : BLACK_CROWN_ROW;
+        removePiece(child, red, king, move.from);
+        addPiece(child, red, king || ((crownRow >> move.to) & 1u), move.to);
+        for (uint32_t bits = move.captures; bits; bits &= bits - 1) {
+            int sq = lowestSquare(bits);
+            removePiece(child, !red, (pos.kings >> sq) & 1u, sq);
+        }
+    }
+
+    // Forward pass from the accumulators; score from the point of view of 'side'
+    int evaluate(const Accumulator& acc, Player side) const {
+        const int16_t* first = acc.values[side == RED ? 0 : 1];
+        const int16_t* second = acc.values[side == RED ? 1 : 0];
+        alignas(32) uint8_t inputs[NNUE_INPUTS];
+        uint8_t hidden[NNUE_LAYER];
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i ceiling = _mm256_set1_epi16(NNUE_ACTIVATION_MAX);
+        for (int half = 0; half < 2; ++half) {
+            const int16_t* values = half == 0 ? first : second;
+            for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+                __m256i a = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(values + i)), zero), ceiling);
+                __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(values + i + 16)), zero), ceiling);
+                // packus interleaves 128-bit lanes; the permute restores the original order
+                __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+                _mm256_store_si256((__m256i*)(inputs + half * NNUE_HIDDEN + i), packed);
+            }
+        }
+        const __m256i ones = _mm256_set1_epi16(1);
+        for (int o = 0; o < NNUE_LAYER; ++o) {
+            __m256i sum = _mm256_setzero_si256();
+            for (int i = 0; i < NNUE_INPUTS; i += 32) {
+                __m256i products = _mm256_maddubs_epi16(_mm256_load_si256((const __m256i*)(inputs + i)),
+                                                        _mm256_loadu_si256((const __m256i*)(layerWeights[o] + i)));
+                sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+            }
+            __m128i folded = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            folded = _mm_add_epi32(folded, _mm_shuffle_epi32(folded, 0x4E));
+            folded = _mm_add_epi32(folded, _mm_shuffle_epi32(folded, 0xB1));
+            hidden[o] = clip((_mm_cvtsi128_si32(folded) + layerBias[o]) >> NNUE_LAYER_SHIFT);
+        }
+        return output(hidden);
+#else
+        return evaluateScalar(first, second, inputs, hidden);
+#endif
+    }
+
+    // Portable forward pass, also used to check the AVX2 path
+    int evaluateScalar(const Accumulator& acc, Player side) const {
+        alignas(32) uint8_t inputs[NNUE_INPUTS];
+        uint8_t hidden[NNUE_LAYER];
+        return evaluateScalar(acc.values[side == RED ? 0 : 1], acc.values[side == RED ? 1 : 0], inputs, hidden);
+    }
+
+    int evaluate(const Position& pos) const {
+        Accumulator acc;
+        refresh(pos, acc);
+        return evaluate(acc, pos.sideToMove);
+    }
+
+private:
+    int evaluateScalar(const int16_t* first, const int16_t* second, uint8_t* inputs, uint8_t* hidden) const {
+        for (int i = 0; i < NNUE_HIDDEN; ++i) {
+            inputs[i] = clip(first[i]);
+            inputs[NNUE_HIDDEN + i] = clip(second[i]);
+        }
+        for (int o = 0; o < NNUE_LAYER; ++o) {
+            int sum = 0;
+            for (int i = 0; i < NNUE_INPUTS; ++i) sum += inputs[i] * layerWeights[o][i];
+            hidden[o] = clip((sum + layerBias[o]) >> NNUE_LAYER_SHIFT);
+        }
+        return output(hidden);
+    }
+};
+
+/**
+ * @class TranspositionTable
+ * @brief Lockless table of search results that several engines can share.
+ *
+ * A slot holds the packed entry and the key XORed with it, both relaxed atomics (plain
+ * loads and stores on x86). A slot torn by two threads writing at once no longer
+ * matches its key and simply reads as empty, so no locks are needed.
+ */
+class TranspositionTable {
+public:
+    enum BoundType { BOUND_NONE = 0, BOUND_EXACT = 1, BOUND_LOWER = 2, BOUND_UPPER = 3 };
+
+    struct Entry {
+        int16_t score;
+        int8_t depth;
+        uint8_t bound;
+        uint8_t bestFrom;
+        uint8_t bestTo;
+    };
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check; // key ^ data
+        std::atomic<uint64_t> data;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+
+    static uint64_t pack(const Entry& entry) {
+        return (uint64_t)(uint16_t)entry.score | (uint64_t)(uint8_t)entry.depth << 16 | (uint64_t)entry.bound << 24 |
+               (uint64_t)entry.bestFrom << 32 | (uint64_t)entry.bestTo << 40;
+    }
+
+    static Entry unpack(uint64_t data) {
+        Entry entry;
+        entry.score = (int16_t)(uint16_t)data;
+        entry.depth = (int8_t)(uint8_t)(data >> 16);
+        entry.bound = (uint8_t)(data >> 24);
+        entry.bestFrom = (uint8_t)(data >> 32);
+        entry.bestTo = (uint8_t)(data >> 40);
+        return entry;
+    }
+
+    TranspositionTable(const TranspositionTable&);            // Non-copyable
+    TranspositionTable& operator=(const TranspositionTable&);
+
+public:
+    explicit TranspositionTable(int megabytes) {
+        size_t entries = 1;
+        while (entries * 2 * sizeof(Slot) <= (size_t)megabytes * 1024 * 1024) entries *= 2;
+        slots.reset(new Slot[entries]);
+        mask = entries - 1;
+        clear();
+    }
+
+    void clear() {
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].check.store(0, std::memory_order_relaxed);
+            slots[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    bool probe(uint64_t key, Entry& entry) const {
+        const Slot& slot = slots[key & mask];
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        if (data == 0 || (slot.check.load(std::memory_order_relaxed) ^ data) != key) return false;
+        entry = unpack(data);
+        return true;
+    }
+
+    void store(uint64_t key, const Entry& entry) {
+        Slot& slot = slots[key & mask];
+        uint64_t data = pack(entry);
+        slot.check.store(key ^ data, std::memory_order_relaxed);
+        slot.data.store(data, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @class Engine
+ * @brief Iterative-deepening alpha-beta searcher over compact positions.
+ *
+ * Consults the opening book at the root and the endgame tablebase at every node
+ * with few enough pieces. Engines searching on different threads may share one
+ * TranspositionTable.
+ */
+class Engine {
+private:
+    typedef TranspositionTable::Entry TTEntry;
+
+    std::shared_ptr<TranspositionTable> table;
+    Tablebase* tablebase;
+    const OpeningBook* book;
+    std::function<void(const SearchResult&)> infoCallback;
+    std::atomic<bool> stopRequested;
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t nodes;
+    bool stopped;
+    FullMove pvTable[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+    std::unique_ptr<MctsSearcher> monteCarlo; // Replaces alpha-beta when set
+    const Evaluator* evaluator;
+    const Network* network;             // Replaces the evaluator when set (not owned)
+    Accumulator accumulators[MAX_PLY];  // Network accumulators of the positions on the search path
+    PositionHistory history;            // The game so far plus the current search path
+
+    // Mate and tablebase scores are stored relative to the node, not the root
+    static int scoreToTable(int score, int ply) {
+        if (score > TB_WIN_SCORE - MAX_PLY) return score + ply;
+        if (score < -TB_WIN_SCORE + MAX_PLY) return score - ply;
+        return score;
+    }
+
+    static int scoreFromTable(int score, int ply) {
+        if (score > TB_WIN_SCORE - MAX_PLY) return score - ply;
+        if (score < -TB_WIN_SCORE + MAX_PLY) return score + ply;
+        return score;
+    }
+
+    void checkLimits() {
+        if (stopRequested.load(std::memory_order_relaxed)) stopped = true;
+        if (limits.maxNodes && nodes >= limits.maxNodes) stopped = true;
+        if (limits.moveTimeMs && elapsedMs() >= limits.moveTimeMs) stopped = true;
+    }
+
+    int staticScore(const Position& pos, const Evaluation& eval, int ply) const {
+        return network ? network->evaluate(accumulators[ply], pos.sideToMove) : evaluator->score(eval, pos.sideToMove);
+    }
+
+    // 'eval' (and accumulators[ply] when a network is set) are maintained incrementally for 'pos'
+    int search(const Position& pos, const Evaluation& eval, int depth, int alpha, int beta, int ply) {
+        pvLength[ply] = ply;
+        if ((++nodes & 1023) == 0) checkLimits();
+        if (stopped) return 0;
+        // Inside the tree a single repetition is as good as the draw it leads to
+        if (ply > 0 && (history.repetitions() > 0 || history.noProgress())) return 0;
+        if (ply >= MAX_PLY - 1) return staticScore(pos, eval, ply);
+
+        if (tablebase && ply > 0 && popCount(pos.occupied()) <= tablebase->maxPieces()) {
+            int result;
+            if (tablebase->probe(pos, result)) {
+                if (result == TB_WIN) return TB_WIN_SCORE - ply;
+                if (result == TB_LOSS) return -TB_WIN_SCORE + ply;
+                return 0;
+            }
+        }
+
+        MoveList moves;
+        if (generateMoves(pos, moves) == 0) return -WIN_SCORE + ply;
+        // Captures are forced, so the horizon only falls on quiet positions
+        if (depth <= 0 && !moves.moves[0].isCapture()) return staticScore(pos, eval, ply);
+
+        uint64_t key = history.lastKey();
+        TTEntry entry;
+        if (table->probe(key, entry)) {
+            int ttScore = scoreFromTable(entry.score, ply);
+            if (ply > 0 && entry.depth >= depth) {
+                if (entry.bound == TranspositionTable::BOUND_EXACT) return ttScore;
+                if (entry.bound == TranspositionTable::BOUND_LOWER && ttScore >= beta) return ttScore;
+                if (entry.bound == TranspositionTable::BOUND_UPPER && ttScore <= alpha) return ttScore;
+            }
+            // Try the stored best move first
+            for (int i = 1; i < moves.count; ++i) {
+                if (moves.moves[i].from == entry.bestFrom && moves.moves[i].to == entry.bestTo) {
+                    std::swap(moves.moves[0], moves.moves[i]);
+                    break;
+                }
+            }
+        }
+
+        int originalAlpha = alpha;
+        int bestScore = -INFINITE_SCORE;
+        int bestIndex = 0;
+        for (int i = 0; i < moves.count; ++i) {
+            Position next = applyMove(pos, moves.moves[i]);
+            Evaluation nextEval = evaluator->update(eval, pos, moves.moves[i]);
+            if (network) network->update(accumulators[ply], pos, moves.moves[i], accumulators[ply + 1]);
+            history.push(hashAfterMove(key, pos, moves.moves[i], next), irreversibleStep(pos, next));
+            int score = -search(next, nextEval, depth - 1, -beta, -alpha, ply + 1);
+            history.pop();
+            if (stopped) return 0;
+
+            if (score > bestScore) {
+                bestScore = score;
+                bestIndex = i;
+                if (score > alpha) {
+                    alpha = score;
+                    pvTable[ply][ply] = moves.moves[i];
+                    for (int p = ply + 1; p < pvLength[ply + 1]; ++p) pvTable[ply][p] = pvTable[ply + 1][p];
+                    pvLength[ply] = pvLength[ply + 1];
+                }
+            }
+            if (alpha >= beta) break;
+        }
+
+        entry.score = (int16_t)scoreToTable(bestScore, ply);
+        entry.depth = (int8_t)std::max(depth, 0);
+        entry.bound = (bestScore >= beta) ? TranspositionTable::BOUND_LOWER
+                      : (bestScore > originalAlpha) ? TranspositionTable::BOUND_EXACT
+                                                    : TranspositionTable::BOUND_UPPER;
+        entry.bestFrom = moves.moves[bestIndex].from;
+        entry.bestTo = moves.moves[bestIndex].to;
+        table->store(key, entry);
+        return bestScore;
+    }
+
+public:
+    explicit Engine(int hashMegabytes = 16)
+        : table(new TranspositionTable(hashMegabytes)), tablebase(nullptr), book(nullptr), stopRequested(false), nodes(0),
+          stopped(false), evaluator(&DEFAULT_EVALUATOR), network(nullptr) {}
+
+    // Replaces this engine's transposition table, e.g. with one shared by other engines
+    void setTable(const std::shared_ptr<TranspositionTable>& shared) { table = shared; }
+
+    void setTablebase(Tablebase* tb) { tablebase = tb; }
+    void setBook(const OpeningBook* openingBook) { book = openingBook; }
+
+    // Replaces the default evaluation weights (the evaluator is not owned)
+    void setEvaluator(const Evaluator* weights) { evaluator = weights ? weights : &DEFAULT_EVALUATOR; }
+
+    // Evaluates with a neural network instead of the evaluator (null switches back)
+    void setNetwork(const Network* net) { network = net; }
+
+    // Switches to Monte Carlo tree search on 'threads' threads (0 switches back to alpha-beta)
+    void setMonteCarlo(int threads, int memoryMegabytes = 64) {
+        monteCarlo.reset(threads > 0 ? new MctsSearcher(threads, memoryMegabytes) : nullptr);
+    }
+
+    void clearHash() { table->clear(); }
+
+    // Called after every completed iteration, e.g. to print protocol "info" lines
+    void setInfoCallback(const std::function<void(const SearchResult&)>& callback) { infoCallback = callback; }
+
+    // May be called from another thread to end the current search early. The request
+    // also stops a search that has not started yet, and is consumed when think() returns.
+    void stop() { stopRequested.store(true); }
+
+    // Discards a stop request that arrived after the last search had already finished
+    void clearStop() { stopRequested.store(false); }
+
+    int64_t elapsedMs() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    // Static evaluation from the point of view of the side to move
+    int evaluate(const Position& pos) const {
+        return network ? network->evaluate(pos) : evaluator->evaluate(pos);
+    }
+
+    // 'game' holds the positions played so far, ending with 'pos'; without it the search
+    // cannot see repetitions of positions before the root
+    SearchResult think(const Position& pos, const SearchLimits& searchLimits, const PositionHistory* game = nullptr) {
+        SearchResult result;
+        uint64_t rootKey = hashPosition(pos);
+        if (game && game->size() > 0 && game->lastKey() == rootKey) history = *game;
+        else history.reset(rootKey);
+        limits = searchLimits;
+        startTime = std::chrono::steady_clock::now();
+        stopped = false;
+        nodes = 0;
+        iterate(pos, result);
+        stopRequested.store(false);
+        result.nodes = nodes;
+        result.timeMs = elapsedMs();
+        return result;
+    }
+
+    // Prepares analyzeMove() calls from 'pos': starts the clock for 'searchLimits' and
+    // takes over the game history like think() does
+    void beginAnalysis(const Position& pos, const SearchLimits& searchLimits, const PositionHistory* game = nullptr) {
+        uint64_t rootKey = hashPosition(pos);
+        if (game && game->size() > 0 && game->lastKey() == rootKey) history = *game;
+        else history.reset(rootKey);
+        limits = searchLimits;
+        startTime = std::chrono::steady_clock::now();
+        stopped = false;
+        nodes = 0;
+    }
+
+    // Full-window search of one root move 'depth' plies deep (the move included), so
+    // every move gets an exact score rather than a bound. Returns false once the limits
+    // or stop() end the analysis; otherwise fills in the score, depth and PV.
+    bool analyzeMove(const Position& pos, const FullMove& move, int depth, SearchResult& result) {
+        if (stopped) return false;
+        Position next = applyMove(pos, move);
+        history.push(hashAfterMove(history.lastKey(), pos, move, next), irreversibleStep(pos, next));
+        if (network) network->refresh(next, accumulators[1]);
+        int score = -search(next, evaluator->compute(next), depth - 1, -INFINITE_SCORE, INFINITE_SCORE, 1);
+        history.pop();
+        if (stopped) return false;
+        result.hasMove = true;
+        result.bestMove = move;
+        result.score = score;
+        result.depth = depth;
+        result.pv.assign(1, move);
+        result.pv.insert(result.pv.end(), pvTable[1] + 1, pvTable[1] + pvLength[1]);
+        result.nodes = nodes;
+        result.timeMs = elapsedMs();
+        return true;
+    }
+
+private:
+    void iterate(const Position& pos, SearchResult& result) {
+        if (book && book->probe(pos, result.bestMove)) {
+            result.hasMove = true;
+            result.fromBook = true;
+            result.pv.push_back(result.bestMove);
+            return;
+        }
+
+        MoveList moves;
+        if (generateMoves(pos, moves) == 0) return;
+        result.hasMove = true;
+        result.bestMove = moves.moves[0];
+        if (moves.count == 1) { // Nothing to think about
+            result.pv.push_back(result.bestMove);
+            return;
+        }
+
+        if (monteCarlo) {
+            SearchResult tree = monteCarlo->think(pos, limits, &stopRequested);
+            nodes = tree.nodes;
+            if (!tree.hasMove) return;
+            result.bestMove = tree.bestMove;
+            result.score = tree.score;
+            result.depth = tree.depth;
+            result.pv = tree.pv;
+            if (infoCallback) {
+                result.nodes = nodes;
+                result.timeMs = elapsedMs();
+                infoCallback(result);
+            }
+            return;
+        }
+
+        int maxDepth = (limits.maxDepth > 0) ? std::min(limits.maxDepth, MAX_PLY - 1) : MAX_PLY - 1;
+        for (int depth = 1; depth <= maxDepth; ++depth) {
+            if (network) network->refresh(pos, accumulators[0]);
+            int score = search(pos, evaluator->compute(pos), depth, -INFINITE_SCORE, INFINITE_SCORE, 0);
+            if (stopped) break;
+            result.score = score;
+            result.depth = depth;
+            result.pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+            if (!result.pv.empty()) result.bestMove = result.pv[0];
+            if (infoCallback) {
+                result.nodes = nodes;
+                result.timeMs = elapsedMs();
+                infoCallback(result);
+            }
+            if (std::abs(score) >= WIN_SCORE - depth) break; // Forced win or loss fully seen
+        }
+    }
+};
+
+// "cp N" for ordinary scores, "win N" for a forced win (negative N: loss) in N plies
+std::string formatScore(int score) {
+    if (std::abs(score) > WIN_SCORE - MAX_PLY) {
+        int plies = WIN_SCORE - std::abs(score);
+        return "win " + std::to_string(score > 0 ? plies : -plies);
+    }
+    return "cp " + std::to_string(score);
+}
+
+/**
+ * @class MultiPvAnalyzer
+ * @brief Scores every legal move of a position, for coaching and analysis.
+ *
+ * Iterates over depths; at each depth the root moves are handed out to the threads one
+ * at a time, so a slow move does not hold the others up. Each thread has its own
+ * Engine, but all of them share one TranspositionTable, so what one thread learns below
+ * a move helps the others. Every finished move is reported through the callback right
+ * away. Moves are searched best-first at the next depth.
+ */
+class MultiPvAnalyzer {
+private:
+    std::shared_ptr<TranspositionTable> table;
+    std::vector<std::unique_ptr<Engine>> engines;
+    std::function<void(const SearchResult&)> callback;
+    std::mutex callbackMutex;
+
+public:
+    MultiPvAnalyzer(int threads, int hashMegabytes) : table(new TranspositionTable(hashMegabytes)) {
+        for (int t = 0; t < std::max(threads, 1); ++t) {
+            engines.push_back(std::unique_ptr<Engine>(new Engine(1)));
+            engines.back()->setTable(table);
+        }
+    }
+
+    // Receives each move's result as soon as one of its searches finishes (called on
+    // the search threads, one at a time)
+    void setCallback(const std::function<void(const SearchResult&)>& onMove) { callback = onMove; }
+
+    void setTablebase(Tablebase* tb) {
+        for (size_t t = 0; t < engines.size(); ++t) engines[t]->setTablebase(tb);
+    }
+
+    // May be called from another thread; analyze() returns with the deepest results so far
+    void stop() {
+        for (size_t t = 0; t < engines.size(); ++t) engines[t]->stop();
+    }
+
+    // Returns one result per legal move, best first, from the deepest iteration that
+    // every move completed. Without a depth, node or time limit the analysis runs until stop().
+    std::vector<SearchResult> analyze(const Position& pos, const SearchLimits& limits, const PositionHistory* game = nullptr) {
+        MoveList moves;
+        generateMoves(pos, moves);
+        std::vector<SearchResult> results(moves.count);
+        for (int i = 0; i < moves.count; ++i) {
+            results[i].bestMove = moves.moves[i];
+            results[i].pv.assign(1, moves.moves[i]);
+        }
+        if (results.empty()) return results;
+
+        for (size_t t = 0; t < engines.size(); ++t) engines[t]->beginAnalysis(pos, limits, game);
+        std::vector<SearchResult> completed; // Every move's result at the last depth all of them finished
+        int maxDepth = (limits.maxDepth > 0) ? std::min(limits.maxDepth, MAX_PLY - 2) : MAX_PLY - 2;
+        for (int depth = 1; depth <= maxDepth; ++depth) {
+            std::atomic<size_t> nextMove(0);
+            std::atomic<bool> interrupted(false);
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < engines.size(); ++t) {
+                workers.push_back(std::thread([this, t, depth, &pos, &results, &nextMove, &interrupted]() {
+                    for (size_t i = nextMove++; i < results.size(); i = nextMove++) {
+                        SearchResult result;
+                        if (!engines[t]->analyzeMove(pos, results[i].bestMove, depth, result)) {
+                            interrupted = true;
+                            return;
+                        }
+                        std::lock_guard<std::mutex> lock(callbackMutex);
+                        results[i] = result;
+                        if (callback) callback(result);
+                    }
+                }));
+            }
+            for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+            if (interrupted) break;
+            std::stable_sort(results.begin(), results.end(),
+                             [](const SearchResult& a, const SearchResult& b) { return a.score > b.score; });
+            completed = results;
+        }
+        for (size_t t = 0; t < engines.size(); ++t) engines[t]->clearStop();
+        if (!completed.empty()) return completed; // Scores of a partly searched depth are not comparable
+
+        // Stopped during the first depth: the moves it scored come first, the rest unscored
+        std::stable_sort(results.begin(), results.end(), [](const SearchResult& a, const SearchResult& b) {
+            return a.depth != b.depth ? a.depth > b.depth : a.score > b.score;
+        });
+        return results;
+    }
+};
+
+/**
+ * @class BatchAnalyzer
+ * @brief Searches a stream of position strings on a thread pool and writes the results
+ * in input order.
+ *
+ * The reading thread hands numbered lines to the workers through a queue. Each worker
+ * has its own Engine. Results finish out of order and wait in a reorder buffer until
+ * every earlier line has been written. The reader never gets more than 'window' lines
+ * ahead of the writer, which bounds both the queue and the buffer however long the
+ * input is.
+ */
+class BatchAnalyzer {
+private:
+    struct Job {
+        uint64_t index;
+        std::string line;
+    };
+
+    SearchLimits limits;
+    int threads;
+    int hashMegabytes; // Per thread
+    uint64_t window;
+    std::mutex mutex;
+    std::condition_variable jobReady; // Workers wait for input
+    std::condition_variable slotFree; // The reader waits for the writer to catch up
+    std::deque<Job> queue;
+    std::map<uint64_t, std::string> pending; // Finished results not yet written
+    uint64_t nextToWrite;
+    bool inputDone;
+    std::ostream* out;
+
+    // One output line: the input, a tab, then the search result or an error
+    std::string analyzeLine(Engine& engine, const std::string& line) const {
+        Position pos;
+        if (!parsePosition(line, pos)) return line + "\terror invalid position";
+        SearchResult result = engine.think(pos, limits);
+        if (!result.hasMove) return line + "\tbestmove none";
+        std::string text = line + "\tbestmove " + moveToString(result.bestMove) + " score " + formatScore(result.score) +
+                           " depth " + std::to_string(result.depth) + " nodes " + std::to_string(result.nodes) + " pv";
+        for (size_t i = 0; i < result.pv.size(); ++i) text += " " + moveToString(result.pv[i]);
+        return text;
+    }
+
+    void worker() {
+        std::unique_ptr<Engine> engine(new Engine(hashMegabytes));
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobReady.wait(lock, [this]() { return !queue.empty() || inputDone; });
+                if (queue.empty()) return;
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+            std::string result = analyzeLine(*engine, job.line);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            pending[job.index] = std::move(result);
+            bool wrote = false;
+            while (!pending.empty() && pending.begin()->first == nextToWrite) {
+                *out << pending.begin()->second << '\n';
+                pending.erase(pending.begin());
+                ++nextToWrite;
+                wrote = true;
+            }
+            if (wrote) slotFree.notify_one();
+        }
+    }
+
+public:
+    BatchAnalyzer(const SearchLimits& searchLimits, int threadCount, int hashMegabytesPerThread)
+        : limits(searchLimits), threads(std::max(threadCount, 1)), hashMegabytes(hashMegabytesPerThread),
+          window((uint64_t)std::max(threadCount, 1) * 64), nextToWrite(0), inputDone(false), out(nullptr) {}
+
+    // Analyzes every non-empty line of 'in' that does not start with '#'; returns the
+    // number of lines written to 'output'
+    uint64_t run(std::istream& in, std::ostream& output) {
+        out = &output;
+        nextToWrite = 0;
+        inputDone = false;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) workers.push_back(std::thread(&BatchAnalyzer::worker, this));
+
+        uint64_t index = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+            if (line.empty() || line[0] == '#') continue;
+            std::unique_lock<std::mutex> lock(mutex);
+            slotFree.wait(lock, [this, index]() { return index - nextToWrite < window; });
+            queue.push_back(Job());
+            queue.back().index = index++;
+            queue.back().line.swap(line);
+            jobReady.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inputDone = true;
+        }
+        jobReady.notify_all();
+        for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+        output.flush();
+        return index;
+    }
+};
+
+// --- 12. SELF-PLAY AND BOOK BUILDING ---
+
+const int SELF_PLAY_MAX_PLIES = 300; // Games that run this long are scored as draws (a backstop to PositionHistory)
+
+// Engine-vs-itself game; the first 'randomPlies' moves are picked at random
+GameRecord playSelfPlayGame(Engine& engine, const SearchLimits& limits, int randomPlies, RandomGenerator& rng) {
+    GameRecord game;
+    game.start = initialPosition();
+    game.result = RESULT_DRAW;
+    Position pos = game.start;
+    PositionHistory history;
+    history.reset(hashPosition(pos));
+
+    for (int ply = 0; ply < SELF_PLAY_MAX_PLIES && !history.isDrawn(); ++ply) {
+        MoveList moves;
+        if (generateMoves(pos, moves) == 0) {
+            game.result = (pos.sideToMove == RED) ? RESULT_BLACK_WINS : RESULT_RED_WINS;
+            break;
+        }
+        FullMove move = moves.moves[0];
+        if (ply < randomPlies) {
+            move = moves.moves[rng.below(moves.count)];
+        } else {
+            SearchResult result = engine.think(pos, limits, &history);
+            if (result.hasMove) move = result.bestMove;
+        }
+        game.moves.push_back(move);
+        Position next = applyMove(pos, move);
+        history.push(hashPosition(next), irreversibleStep(pos, next));
+        pos = next;
+    }
+    return game;
+}
+
+/**
+ * @class OpeningBookBuilder
+ * @brief Aggregates game results per (position, move) and writes a sorted book file.
+ */
+class OpeningBookBuilder {
+private:
+    struct Counts {
+        uint32_t wins;
+        uint32_t draws;
+        uint32_t losses;
+    };
+
+    int maxPly;
+    std::map<std::pair<uint64_t, uint16_t>, Counts> entries;
+
+public:
+    explicit OpeningBookBuilder(int bookPlies) : maxPly(bookPlies) {}
+
+    void addGame(const GameRecord& game) {
+        if (game.result == RESULT_UNKNOWN) return;
+        Position pos = game.start;
+        for (size_t ply = 0; ply < game.moves.size() && (int)ply < maxPly; ++ply) {
+            const FullMove& move = game.moves[ply];
+            Counts& counts = entries[std::make_pair(hashPosition(pos), (uint16_t)(move.from << 8 | move.to))];
+            bool moverWon = (game.result == RESULT_RED_WINS && pos.sideToMove == RED) ||
+                            (game.result == RESULT_BLACK_WINS && pos.sideToMove == BLACK);
+            if (game.result == RESULT_DRAW) counts.draws++;
+            else if (moverWon) counts.wins++;
+            else counts.losses++;
+            pos = applyMove(pos, move);
+        }
+    }
+
+    // Imports every complete, legal game of a PDN file. Returns the number of games used.
+    int importPdn(const MappedFile& file) {
+        const char* text = (const char*)file.data();
+        PdnReader reader(text, text + file.size());
+        GameRecord game;
+        bool valid;
+        int imported = 0;
+        while (reader.nextGame(game, valid)) {
+            if (!valid || game.result == RESULT_UNKNOWN) continue;
+            addGame(game);
+            ++imported;
+        }
+        return imported;
+    }
+
+    bool write(const std::string& path) const {
+        FILE* out = std::fopen(path.c_str(), "wb");
+        if (!out) return false;
+        BookFileHeader header;
+        std::memcpy(header.magic, BOOK_MAGIC, sizeof(header.magic));
+        header.recordCount = entries.size();
+        bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+
+        // std::map iterates in (key, from, to) order, which is the on-disk order
+        std::map<std::pair<uint64_t, uint16_t>, Counts>::const_iterator it;
+        for (it = entries.begin(); ok && it != entries.end(); ++it) {
+            BookRecord record;
+            record.key = it->first.first;
+            record.from = (uint8_t)(it->first.second >> 8);
+            record.to = (uint8_t)(it->first.second & 0xFF);
+            record.reserved = 0;
+            record.wins = it->second.wins;
+            record.draws = it->second.draws;
+            record.losses = it->second.losses;
+            ok = std::fwrite(&record, sizeof(record), 1, out) == 1;
+        }
+        return std::fclose(out) == 0 && ok;
+    }
+
+    size_t size() const { return entries.size(); }
+};
+
+// --- 13. TRAINING DATA AND EVALUATION TUNING ---
+
+/**
+ * @struct TrainingRecord
+ * @brief One labelled position as stored in training files.
+ *
+ * Training files are flat arrays of these records without a header, so several writers
+ * can append to them and readers map them straight into memory. 'score' is a search
+ * score from the side to move's point of view and 'result' the GameResult of the game
+ * the position came from.
+ */
+struct TrainingRecord {
+    uint32_t red;
+    uint32_t black;
+    uint32_t kings;
+    uint8_t sideToMove;
+    uint8_t result;
+    int16_t score;
+};
+
+static_assert(sizeof(TrainingRecord) == 16, "Training records are 16 bytes on disk");
+
+const double TUNE_SCORE_SCALE = 200.0; // Evaluation units per logistic unit of win probability
+const double ADAM_BETA1 = 0.9;
+const double ADAM_BETA2 = 0.999;
+const double ADAM_EPSILON = 1e-8;
+
+/**
+ * @struct TuneOptions
+ * @brief Settings of one tuning run.
+ *
+ * 'lambda' blends the two labels: 0 fits game results only, 1 fits search scores only.
+ */
+struct TuneOptions {
+    int threads;
+    int epochs;
+    size_t batchSize;
+    double learningRate; // Adam step size in evaluation units
+    double lambda;
+
+    TuneOptions() : threads(1), epochs(10), batchSize(65536), learningRate(1.0), lambda(0.5) {}
+};
+
+/**
+ * @class EvaluationTuner
+ * @brief Fits the Evaluator's weights to a mapped file of training records.
+ *
+ * The evaluation is a sum of feature weights, so the predicted win probability
+ * sigmoid(eval / TUNE_SCORE_SCALE) has a cheap exact gradient. Each mini-batch is split
+ * across threads that sum loss and gradient into their own accumulators; the main
+ * thread adds those up and takes one Adam step. Weights are kept as doubles while
+ * tuning and rounded into the Evaluator's integer tables afterwards.
+ */
+class EvaluationTuner {
+private:
+    MappedFile file;
+    const TrainingRecord* records;
+    size_t count;
+    Evaluator evaluator;
+    std::vector<double> weights;
+    std::vector<double> firstMoment;
+    std::vector<double> secondMoment;
+    std::vector<std::vector<double>> gradients; // One accumulator per thread
+    uint64_t steps;
+
+    static Position recordPosition(const TrainingRecord& record) {
+        Position pos;
+        pos.red = record.red;
+        pos.black = record.black & ~record.red;
+        pos.kings = record.kings & pos.occupied();
+        pos.sideToMove = record.sideToMove == BLACK ? BLACK : RED;
+        return pos;
+    }
+
+    static double winProbability(double score) {
+        return 1.0 / (1.0 + std::exp(-score / TUNE_SCORE_SCALE));
+    }
+
+    // Probability that RED wins according to the record's labels
+    static double target(const TrainingRecord& record, double lambda) {
+        double result = record.result == RESULT_RED_WINS ? 1.0 : record.result == RESULT_BLACK_WINS ? 0.0 : 0.5;
+        double score = record.sideToMove == BLACK ? -record.score : record.score;
+        return lambda * winProbability(score) + (1.0 - lambda) * result;
+    }
+
+    // Adds the gradient of records [begin, end) to 'gradient' and returns their summed loss
+    double accumulate(size_t begin, size_t end, double lambda, std::vector<double>& gradient) const {
+        int indices[NUM_SQUARES + EVAL_REGIONS];
+        double loss = 0.0;
+        for (size_t i = begin; i < end; ++i) {
+            int active = evaluator.features(recordPosition(records[i]), indices);
+            double eval = 0.0;
+            for (int k = 0; k < active; ++k) eval += weights[indices[k]];
+            double predicted = winProbability(eval);
+            double error = predicted - target(records[i], lambda);
+            loss += error * error;
+            double slope = 2.0 * error * predicted * (1.0 - predicted) / TUNE_SCORE_SCALE;
+            for (int k = 0; k < active; ++k) gradient[indices[k]] += slope;
+        }
+        return loss;
+    }
+
+    // Computes the gradient of one mini-batch on all threads and applies an Adam step
+    double step(size_t begin, size_t end, const TuneOptions& options) {
+        int threads = (int)gradients.size();
+        std::vector<double> losses(threads, 0.0);
+        size_t chunk = (end - begin + threads - 1) / threads;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            size_t from = std::min(end, begin + t * chunk);
+            size_t to = std::min(end, from + chunk);
+            workers.push_back(std::thread([this, from, to, t, &options, &losses]() {
+                std::fill(gradients[t].begin(), gradients[t].end(), 0.0);
+                losses[t] = accumulate(from, to, options.lambda, gradients[t]);
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+
+        ++steps;
+        double scale = 1.0 / (double)(end - begin);
+        double correction1 = 1.0 - std::pow(ADAM_BETA1, (double)steps);
+        double correction2 = 1.0 - std::pow(ADAM_BETA2, (double)steps);
+        double loss = 0.0;
+        for (int t = 0; t < threads; ++t) loss += losses[t];
+        for (int i = 0; i < Evaluator::PARAMETERS; ++i) {
+            double g = 0.0;
+            for (int t = 0; t < threads; ++t) g += gradients[t][i];
+            g *= scale;
+            firstMoment[i] = ADAM_BETA1 * firstMoment[i] + (1.0 - ADAM_BETA1) * g;
+            secondMoment[i] = ADAM_BETA2 * secondMoment[i] + (1.0 - ADAM_BETA2) * g * g;
+            weights[i] -= options.learningRate * (firstMoment[i] / correction1) /
+                          (std::sqrt(secondMoment[i] / correction2) + ADAM_EPSILON);
+        }
+        return loss;
+    }
+
+public:
+    EvaluationTuner() : records(nullptr), count(0), steps(0) {
+        evaluator.getParameters(weights);
+    }
+
+    // Maps a training file; fails unless it holds a whole number of records
+    bool open(const std::string& path) {
+        if (!file.open(path) || file.size() == 0 || file.size() % sizeof(TrainingRecord) != 0) return false;
+        records = (const TrainingRecord*)file.data();
+        count = file.size() / sizeof(TrainingRecord);
+        return true;
+    }
+
+    // Starts tuning from the given weights (the built-in ones by default)
+    void setInitialWeights(const Evaluator& initial) {
+        evaluator = initial;
+        evaluator.getParameters(weights);
+    }
+
+    size_t size() const { return count; }
+
+    // Mean squared error of the current weights over the whole file
+    double meanLoss(const TuneOptions& options) {
+        gradients.assign(std::max(options.threads, 1), std::vector<double>(Evaluator::PARAMETERS, 0.0));
+        std::vector<double> losses(gradients.size(), 0.0);
+        size_t chunk = (count + gradients.size() - 1) / gradients.size();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < gradients.size(); ++t) {
+            size_t from = std::min(count, t * chunk);
+            size_t to = std::min(count, from + chunk);
+            workers.push_back(std::thread([this, from, to, t, &options, &losses]() {
+                losses[t] = accumulate(from, to, options.lambda, gradients[t]);
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+        double loss = 0.0;
+        for (size_t t = 0; t < losses.size(); ++t) loss += losses[t];
+        return loss / (double)count;
+    }
+
+    // Runs the configured number of epochs; 'progress' receives the epoch, its mean
+    // training loss and the positions per second
+    void tune(const TuneOptions& options, const std::function<void(int, double, double)>& progress) {
+        firstMoment.assign(Evaluator::PARAMETERS, 0.0);
+        secondMoment.assign(Evaluator::PARAMETERS, 0.0);
+        gradients.assign(std::max(options.threads, 1), std::vector<double>(Evaluator::PARAMETERS, 0.0));
+        steps = 0;
+        size_t batch = std::max<size_t>(options.batchSize, 1);
+
+        for (int epoch = 1; epoch <= options.epochs; ++epoch) {
+            auto start = std::chrono::steady_clock::now();
+            double loss = 0.0;
+            for (size_t begin = 0; begin < count; begin += batch) loss += step(begin, std::min(count, begin + batch), options);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            evaluator.setParameters(weights);
+            if (progress) progress(epoch, loss / (double)count, seconds > 0.0 ? (double)count / seconds : 0.0);
+        }
+    }
+
+    const Evaluator& result() const { return evaluator; }
+};
+
+/**
+ * @class TrainingWriter
+ * @brief Buffered, append-only writer of training records.
+ *
+ * Every generator thread owns one writer. Records are collected in memory and written
+ * in whole blocks to a file opened for appending, so threads appending to the same
+ * file never interleave partial records.
+ */
+class TrainingWriter {
+private:
+    std::vector<TrainingRecord> buffer;
+    size_t capacity;
+#if defined(_WIN32)
+    FILE* file;
+#else
+    int fd;
+#endif
+    bool failed;
+
+    TrainingWriter(const TrainingWriter&);            // Non-copyable
+    TrainingWriter& operator=(const TrainingWriter&);
+
+public:
+    explicit TrainingWriter(const std::string& path, size_t bufferedRecords = 4096)
+        : capacity(std::max<size_t>(bufferedRecords, 1)), failed(false) {
+        buffer.reserve(capacity);
+#if defined(_WIN32)
+        file = std::fopen(path.c_str(), "ab");
+        if (file) std::setvbuf(file, nullptr, _IONBF, 0);
+        failed = file == nullptr;
+#else
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        failed = fd < 0;
+#endif
+    }
+
+    ~TrainingWriter() {
+        close();
+    }
+
+    bool isOpen() const { return !failed; }
+
+    void add(const TrainingRecord& record) {
+        buffer.push_back(record);
+        if (buffer.size() >= capacity) flush();
+    }
+
+    bool flush() {
+        if (buffer.empty() || failed) {
+            buffer.clear();
+            return !failed;
+        }
+        size_t bytes = buffer.size() * sizeof(TrainingRecord);
+#if defined(_WIN32)
+        failed = std::fwrite(buffer.data(), 1, bytes, file) != bytes;
+#else
+        failed = ::write(fd, buffer.data(), bytes) != (ssize_t)bytes;
+#endif
+        buffer.clear();
+        return !failed;
+    }
+
+    bool close() {
+        flush();
+#if defined(_WIN32)
+        if (file) std::fclose(file);
+        file = nullptr;
+#else
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        return !failed;
+    }
+};
+
+/**
+ * @struct DataGenOptions
+ * @brief Settings of a training-data generation run.
+ */
+struct DataGenOptions {
+    int threads;
+    int games;
+    int randomPlies;  // Openings are randomized for between half of this and this many plies
+    int hashMegabytes; // Per thread
+    SearchLimits limits;
+
+    DataGenOptions() : threads(1), games(1000), randomPlies(8), hashMegabytes(16) {
+        limits.maxDepth = 6;
+    }
+};
+
+// Plays one engine-vs-itself game from a randomized opening and appends its quiet
+// positions (no capture pending) with their search scores to 'records'; the game
+// result is filled in once it is known
+GameResult playTrainingGame(Engine& engine, const DataGenOptions& options, RandomGenerator& rng,
+                            std::vector<TrainingRecord>& records) {
+    size_t first = records.size();
+    GameResult result = RESULT_DRAW;
+    int randomPlies = options.randomPlies / 2 + rng.below(options.randomPlies - options.randomPlies / 2 + 1);
+    Position pos = initialPosition();
+    PositionHistory history;
+    history.reset(hashPosition(pos));
+    engine.clearHash();
+
+    for (int ply = 0; ply < SELF_PLAY_MAX_PLIES && !history.isDrawn(); ++ply) {
+        MoveList moves;
+        if (generateMoves(pos, moves) == 0) {
+            result = (pos.sideToMove == RED) ? RESULT_BLACK_WINS : RESULT_RED_WINS;
+            break;
+        }
+        FullMove move = moves.moves[rng.below(moves.count)];
+        if (ply >= randomPlies) {
+            SearchResult search = engine.think(pos, options.limits, &history);
+            if (search.hasMove) move = search.bestMove;
+            // Forced single replies and book moves come back unsearched with a score of 0,
+            // which would teach the tuner that the position is level
+            if (moves.moves[0].captures == 0 && moves.count > 1 && search.depth > 0 && !search.fromBook) {
+                TrainingRecord record;
+                record.red = pos.red;
+                record.black = pos.black;
+                record.kings = pos.kings;
+                record.sideToMove = (uint8_t)pos.sideToMove;
+                record.result = RESULT_UNKNOWN;
+                record.score = (int16_t)std::max(-32767, std::min(32767, search.score));
+                records.push_back(record);
+            }
+        }
+        Position next = applyMove(pos, move);
+        history.push(hashPosition(next), irreversibleStep(pos, next));
+        pos = next;
+    }
+    for (size_t i = first; i < records.size(); ++i) records[i].result = (uint8_t)result;
+    return result;
+}
+
+/**
+ * @class TrainingDataGenerator
+ * @brief Plays self-play games on several threads and appends their positions to a file.
+ *
+ * Each thread has its own engine, random generator and TrainingWriter; the only shared
+ * state is the counters, so threads never wait for each other.
+ */
+class TrainingDataGenerator {
+private:
+    DataGenOptions options;
+    std::string path;
+    std::atomic<int> gamesStarted;
+    std::atomic<int> gamesFinished;
+    std::atomic<uint64_t> positions;
+    std::atomic<bool> writeFailed;
+    std::atomic<int> running;
+
+    void worker(int index) {
+        std::unique_ptr<Engine> engine(new Engine(options.hashMegabytes));
+        RandomGenerator rng((uint64_t)std::chrono::steady_clock::now().time_since_epoch().count() + 0x9E3779B97F4A7C15ull * (index + 1));
+        TrainingWriter writer(path);
+        std::vector<TrainingRecord> game;
+        while (writer.isOpen() && gamesStarted.fetch_add(1) < options.games) {
+            game.clear();
+            playTrainingGame(*engine, options, rng, game);
+            for (size_t i = 0; i < game.size(); ++i) writer.add(game[i]);
+            positions += game.size();
+            gamesFinished++;
+        }
+        if (!writer.close()) writeFailed = true;
+        running--;
+    }
+
+public:
+    TrainingDataGenerator(const DataGenOptions& settings, const std::string& outputPath)
+        : options(settings), path(outputPath), gamesStarted(0), gamesFinished(0), positions(0), writeFailed(false),
+          running(0) {}
+
+    // Runs all games; 'progress' is called about every 'reportSeconds' with the games
+    // finished and positions written so far
+    bool run(int reportSeconds, const std::function<void(int, uint64_t)>& progress) {
+        std::vector<std::thread> workers;
+        int threadCount = std::max(options.threads, 1);
+        running = threadCount;
+        for (int t = 0; t < threadCount; ++t) workers.push_back(std::thread(&TrainingDataGenerator::worker, this, t));
+        auto lastReport = std::chrono::steady_clock::now();
+        while (running.load() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            auto now = std::chrono::steady_clock::now();
+            if (progress && now - lastReport >= std::chrono::seconds(reportSeconds)) {
+                progress(gamesFinished.load(), positions.load());
+                lastReport = now;
+            }
+        }
+        for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+        return !writeFailed.load();
+    }
+
+    int gamesPlayed() const { return gamesFinished.load(); }
+    uint64_t positionsWritten() const { return positions.load(); }
+};
+
+// --- 14. ENGINE MATCHES ---
+
+/**
+ * @struct EngineConfig
+ * @brief One side of a match, parsed from a spec like "name=new,depth=8,hash=32,book=FILE".
+ */
+struct EngineConfig {
+    std::string name;
+    SearchLimits limits;
+    int hashMegabytes;
+    int mctsThreads; // Non-zero selects Monte Carlo tree search
+    std::shared_ptr<OpeningBook> book;
+    std::shared_ptr<Tablebase> tablebase;
+    std::shared_ptr<Network> network;
+    std::shared_ptr<Evaluator> evaluator;
+
+    EngineConfig() : hashMegabytes(16), mctsThreads(0) {}
+
+    bool parse(const std::string& spec) {
+        name = spec;
+        size_t start = 0;
+        while (start < spec.size()) {
+            size_t comma = spec.find(',', start);
+            if (comma == std::string::npos) comma = spec.size();
+            std::string item = spec.substr(start, comma - start);
+            start = comma + 1;
+            size_t equals = item.find('=');
+            if (equals == std::string::npos) return false;
+            std::string key = item.substr(0, equals);
+            std::string value = item.substr(equals + 1);
+
+            if (key == "name") name = value;
+            else if (key == "depth") limits.maxDepth = std::atoi(value.c_str());
+            else if (key == "nodes") limits.maxNodes = std::strtoull(value.c_str(), nullptr, 10);
+            else if (key == "movetime") limits.moveTimeMs = std::atoi(value.c_str());
+            else if (key == "hash") hashMegabytes = std::atoi(value.c_str());
+            else if (key == "mcts") mctsThreads = std::atoi(value.c_str());
+            else if (key == "book") {
+                book.reset(new OpeningBook());
+                if (!book->open(value)) return false;
+            } else if (key == "tb") {
+                tablebase.reset(new Tablebase());
+                if (!tablebase->open(value)) return false;
+            } else if (key == "nnue") {
+                network.reset(new Network());
+                if (!network->load(value)) return false;
+            } else if (key == "eval") {
+                evaluator.reset(new Evaluator());
+                if (!evaluator->load(value)) return false;
+            } else {
+                return false;
+            }
+        }
+        return limits.maxDepth > 0 || limits.maxNodes > 0 || limits.moveTimeMs > 0;
+    }
+
+    std::unique_ptr<Engine> createEngine() const {
+        std::unique_ptr<Engine> engine(new Engine(hashMegabytes));
+        if (book) engine->setBook(book.get());
+        if (tablebase) engine->setTablebase(tablebase.get());
+        if (mctsThreads > 0) engine->setMonteCarlo(mctsThreads, hashMegabytes);
+        if (network) engine->setNetwork(network.get());
+        if (evaluator) engine->setEvaluator(evaluator.get());
+        return engine;
+    }
+};
+
+// Plays out a game from the end of an opening; returns the result and the total ply count
+GameResult playEngineGame(Engine& red, const SearchLimits& redLimits, Engine& black, const SearchLimits& blackLimits,
+                          const GameRecord& opening, int& plies) {
+    Position pos = opening.start;
+    PositionHistory history;
+    history.reset(hashPosition(pos));
+    for (size_t i = 0; i < opening.moves.size(); ++i) {
+        Position next = applyMove(pos, opening.moves[i]);
+        history.push(hashPosition(next), irreversibleStep(pos, next));
+        pos = next;
+    }
+    red.clearHash();
+    black.clearHash();
+
+    for (plies = (int)opening.moves.size(); plies < SELF_PLAY_MAX_PLIES && !history.isDrawn(); ++plies) {
+        bool redToMove = pos.sideToMove == RED;
+        SearchResult result = redToMove ? red.think(pos, redLimits, &history) : black.think(pos, blackLimits, &history);
+        if (!result.hasMove) return redToMove ? RESULT_BLACK_WINS : RESULT_RED_WINS;
+        Position next = applyMove(pos, result.bestMove);
+        history.push(hashPosition(next), irreversibleStep(pos, next));
+        pos = next;
+    }
+    return RESULT_DRAW;
+}
+
+// Every distinct opening 'plies' moves deep whose shallow search score is within 'margin'
+std::vector<GameRecord> balancedOpenings(int plies, int margin) {
+    std::vector<GameRecord> openings;
+    std::vector<GameRecord> frontier(1);
+    frontier[0].start = initialPosition();
+    frontier[0].result = RESULT_UNKNOWN;
+    for (int ply = 0; ply < plies; ++ply) {
+        std::vector<GameRecord> next;
+        for (size_t i = 0; i < frontier.size(); ++i) {
+            Position pos = frontier[i].start;
+            for (size_t m = 0; m < frontier[i].moves.size(); ++m) pos = applyMove(pos, frontier[i].moves[m]);
+            MoveList moves;
+            generateMoves(pos, moves);
+            for (int m = 0; m < moves.count; ++m) {
+                next.push_back(frontier[i]);
+                next.back().moves.push_back(moves.moves[m]);
+            }
+        }
+        frontier.swap(next);
+    }
+
+    Engine engine(4);
+    SearchLimits limits;
+    limits.maxDepth = 8;
+    for (size_t i = 0; i < frontier.size(); ++i) {
+        Position pos = frontier[i].start;
+        for (size_t m = 0; m < frontier[i].moves.size(); ++m) pos = applyMove(pos, frontier[i].moves[m]);
+        SearchResult result = engine.think(pos, limits);
+        if (result.hasMove && std::abs(result.score) <= margin) openings.push_back(frontier[i]);
+    }
+    return openings;
+}
+
+/**
+ * @class SprtTest
+ * @brief Sequential probability ratio test over game pairs (pentanomial model).
+ *
+ * Each opening is played twice with colours reversed and the pair score
+ * (0, 1/4, ..., 1) is the sample, which removes most of the opening bias. The
+ * log-likelihood ratio uses the usual normal approximation for Elo hypotheses
+ * elo0 (H0) and elo1 (H1).
+ */
+class SprtTest {
+private:
+    double elo0, elo1;
+    double lowerBound, upperBound;
+    uint64_t pairCounts[5];
+
+    static double expectedScore(double elo) {
+        return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+    }
+
+public:
+    SprtTest(double e0, double e1, double alpha, double beta)
+        : elo0(e0), elo1(e1), lowerBound(std::log(beta / (1.0 - alpha))), upperBound(std::log((1.0 - beta) / alpha)) {
+        for (int i = 0; i < 5; ++i) pairCounts[i] = 0;
+    }
+
+    // Pair score in quarter points: 0 (two losses) ... 4 (two wins)
+    void addPair(int quarterPoints) {
+        pairCounts[std::min(std::max(quarterPoints, 0), 4)]++;
+    }
+
+    uint64_t pairs() const {
+        return pairCounts[0] + pairCounts[1] + pairCounts[2] + pairCounts[3] + pairCounts[4];
+    }
+
+    double meanScore() const {
+        uint64_t n = pairs();
+        if (n == 0) return 0.5;
+        double sum = 0.0;
+        for (int i = 0; i < 5; ++i) sum += pairCounts[i] * (i / 4.0);
+        return sum / n;
+    }
+
+    double variance() const {
+        uint64_t n = pairs();
+        if (n == 0) return 0.0;
+        double mean = meanScore();
+        double sum = 0.0;
+        for (int i = 0; i < 5; ++i) sum += pairCounts[i] * (i / 4.0 - mean) * (i / 4.0 - mean);
+        return sum / n;
+    }
+
+    double llr() const {
+        double var = variance();
+        if (var <= 0.0) return 0.0;
+        double s0 = expectedScore(elo0);
+        double s1 = expectedScore(elo1);
+        return pairs() * (s1 - s0) * (2.0 * meanScore() - s0 - s1) / (2.0 * var);
+    }
+
+    // +1 accepts H1 (elo >= elo1), -1 accepts H0 (elo <= elo0), 0 keeps going
+    int decision() const {
+        double value = llr();
+        if (value >= upperBound) return 1;
+        if (value <= lowerBound) return -1;
+        return 0;
+    }
+
+    double lower() const { return lowerBound; }
+    double upper() const { return upperBound; }
+};
+
+inline double scoreToElo(double score) {
+    score = std::min(std::max(score, 1e-6), 1.0 - 1e-6);
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+const char MATCH_MAGIC[8] = {'C', 'K', 'M', 'A', 'T', 'C', 'H', '1'};
+
+// One finished game in the results file
+struct MatchGameRecord {
+    uint32_t opening;
+    uint8_t firstEngineColor; // Player value of the first engine
+    uint8_t result;           // GameResult
+    uint16_t plies;
+};
+
+/**
+ * @class Match
+ * @brief Plays two engine configurations against each other on all cores.
+ *
+ * Worker threads take game pairs from a shared counter. Each worker has its own
+ * engines, so no search state is shared. After every pair the SPRT is updated,
+ * and once it reaches a decision no new pairs are started.
+ */
+class Match {
+private:
+    const EngineConfig& first;
+    const EngineConfig& second;
+    const std::vector<GameRecord>& openings;
+    SprtTest& sprt;
+    FILE* results;
+    uint64_t maxPairs;
+    std::atomic<uint64_t> nextPair;
+    std::atomic<bool> decided;
+    std::mutex resultMutex;
+    uint64_t wins, losses, draws; // From the first engine's point of view
+
+    // Score of the first engine in quarter points (win = 2, draw = 1)
+    static int firstEngineQuarterPoints(GameResult result, Player firstColor) {
+        if (result == RESULT_DRAW) return 1;
+        bool redWon = result == RESULT_RED_WINS;
+        return (redWon == (firstColor == RED)) ? 2 : 0;
+    }
+
+    void record(uint32_t opening, const GameResult games[2], const int plies[2]) {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        int pairPoints = 0;
+        for (int g = 0; g < 2; ++g) {
+            Player firstColor = (g == 0) ? RED : BLACK;
+            int points = firstEngineQuarterPoints(games[g], firstColor);
+            pairPoints += points;
+            if (points == 2) ++wins;
+            else if (points == 1) ++draws;
+            else ++losses;
+            if (results) {
+                MatchGameRecord entry = {opening, (uint8_t)firstColor, (uint8_t)games[g], (uint16_t)plies[g]};
+                std::fwrite(&entry, sizeof(entry), 1, results);
+            }
+        }
+        sprt.addPair(pairPoints);
+        if (sprt.decision() != 0) decided.store(true);
+
+        if (sprt.pairs() % 10 == 0 || decided.load()) {
+            std::cout << "Games " << 2 * sprt.pairs() << ": +" << wins << " -" << losses << " =" << draws
+                      << "  Elo " << scoreToElo(sprt.meanScore()) << "  LLR " << sprt.llr() << " [" << sprt.lower()
+                      << ", " << sprt.upper() << "]" << std::endl;
+        }
+    }
+
+    void worker() {
+        std::unique_ptr<Engine> firstEngine = first.createEngine();
+        std::unique_ptr<Engine> secondEngine = second.createEngine();
+        for (uint64_t pair = nextPair.fetch_add(1); pair < maxPairs && !decided.load(); pair = nextPair.fetch_add(1)) {
+            const GameRecord& opening = openings[pair % openings.size()];
+            GameResult games[2];
+            int plies[2];
+            games[0] = playEngineGame(*firstEngine, first.limits, *secondEngine, second.limits, opening, plies[0]);
+            games[1] = playEngineGame(*secondEngine, second.limits, *firstEngine, first.limits, opening, plies[1]);
+            record((uint32_t)(pair % openings.size()), games, plies);
+        }
+    }
+
+public:
+    Match(const EngineConfig& a, const EngineConfig& b, const std::vector<GameRecord>& openingList, SprtTest& test,
+          FILE* resultFile, uint64_t pairLimit)
+        : first(a), second(b), openings(openingList), sprt(test), results(resultFile), maxPairs(pairLimit),
+          nextPair(0), decided(false), wins(0), losses(0), draws(0) {}
+
+    void run(int threads) {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < std::max(threads, 1); ++t) workers.push_back(std::thread(&Match::worker, this));
+        for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    }
+};
+
+// --- 15. ENGINE PROTOCOL ---
+
+/**
+ * @class ProtocolSession
+ * @brief Line-based engine protocol over stdin/stdout, modelled on UCI.
+ *
+ *   checkers                          -> id lines, options, "checkersok"
+ *   isready                           -> "readyok" (answered even while searching)
+ *   setoption name Hash|Book|Tablebase|MCTS|Network value V   (MCTS: search threads, 0 = alpha-beta)
+ *   newgame
+ *   position startpos|fen POSITION [moves M1 M2 ...]
+ *   go [depth N] [nodes N] [movetime MS] [rtime MS] [btime MS] [rinc MS] [binc MS] [infinite]
+ *   stop | quit
+ *
+ * While searching the engine prints "info depth .. score cp|win .. nodes .. nps .. time .. pv .."
+ * after every iteration and finally "bestmove MOVE". The main thread keeps reading
+ * input while the search runs on its own thread, so "stop" takes effect at once.
+ */
+class ProtocolSession {
+private:
+    std::unique_ptr<Engine> engine;
+    OpeningBook book;
+    Tablebase tablebase;
+    std::unique_ptr<Network> network;
+    int hashMegabytes;
+    int mctsThreads; // Non-zero selects Monte Carlo tree search
+    Position position;
+    PositionHistory history; // Positions of the game up to 'position', for repetition draws
+    std::thread searchThread;
+    std::mutex outputMutex;
+
+    void send(const std::string& line) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << line << '\n';
+        std::cout.flush();
+    }
+
+    void sendInfo(const SearchResult& result) {
+        std::string line = "info depth " + std::to_string(result.depth) + " score " + formatScore(result.score) +
+                           " nodes " + std::to_string(result.nodes) + " nps " +
+                           std::to_string(result.timeMs > 0 ? result.nodes * 1000 / (uint64_t)result.timeMs : result.nodes) +
+                           " time " + std::to_string(result.timeMs) + " pv";
+        for (size_t i = 0; i < result.pv.size(); ++i) line += " " + moveToString(result.pv[i]);
+        send(line);
+    }
+
+    void createEngine() {
+        stopSearch();
+        engine.reset(new Engine(hashMegabytes));
+        if (book.isOpen()) engine->setBook(&book);
+        if (tablebase.isOpen()) engine->setTablebase(&tablebase);
+        if (mctsThreads > 0) engine->setMonteCarlo(mctsThreads, hashMegabytes);
+        if (network) engine->setNetwork(network.get());
+        engine->setInfoCallback([this](const SearchResult& result) { sendInfo(result); });
+    }
+
+    void stopSearch() {
+        if (searchThread.joinable()) {
+            engine->stop();
+            searchThread.join();
+        }
+    }
+
+    void handleSetOption(std::istringstream& in) {
+        std::string word, name, value;
+        in >> word >> name >> word;
+        std::getline(in >> std::ws, value);
+        if (name == "Hash") {
+            hashMegabytes = std::max(1, std::atoi(value.c_str()));
+            createEngine();
+        } else if (name == "Book") {
+            stopSearch();
+            if (!book.open(value)) send("info string could not open book " + value);
+            createEngine();
+        } else if (name == "Tablebase") {
+            stopSearch();
+            if (!tablebase.open(value)) send("info string could not open tablebase " + value);
+            createEngine();
+        } else if (name == "MCTS") {
+            mctsThreads = std::max(0, std::atoi(value.c_str()));
+            createEngine();
+        } else if (name == "Network") {
+            stopSearch();
+            network.reset(new Network());
+            if (!network->load(value)) {
+                send("info string could not load network " + value);
+                network.reset();
+            }
+            createEngine();
+        } else {
+            send("info string unknown option " + name);
+        }
+    }
+
+    void handlePosition(std::istringstream& in) {
+        std::string word;
+        in >> word;
+        Position pos = initialPosition();
+        if (word == "fen") {
+            std::string fen;
+            in >> fen;
+            if (!parsePosition(fen, pos)) {
+                send("info string invalid position " + fen);
+                return;
+            }
+            in >> word;
+        } else if (word == "startpos") {
+            in >> word;
+        }
+        PositionHistory game;
+        game.reset(hashPosition(pos));
+        if (word == "moves") {
+            while (in >> word) {
+                FullMove move;
+                if (!parseMove(pos, word, move)) {
+                    send("info string illegal move " + word);
+                    return;
+                }
+                Position next = applyMove(pos, move);
+                game.push(hashPosition(next), irreversibleStep(pos, next));
+                pos = next;
+            }
+        }
+        position = pos;
+        history = game;
+    }
+
+    void handleGo(std::istringstream& in) {
+        stopSearch();
+        SearchLimits limits;
+        int64_t remaining[2] = {0, 0}, increment[2] = {0, 0}; // RED, BLACK
+        std::string word;
+        while (in >> word) {
+            int64_t value = 0;
+            if (word == "infinite") {
+                limits.infinite = true;
+                continue;
+            }
+            in >> value;
+            if (word == "depth") limits.maxDepth = (int)value;
+            else if (word == "nodes") limits.maxNodes = (uint64_t)value;
+            else if (word == "movetime") limits.moveTimeMs = value;
+            else if (word == "rtime") remaining[0] = value;
+            else if (word == "btime") remaining[1] = value;
+            else if (word == "rinc") increment[0] = value;
+            else if (word == "binc") increment[1] = value;
+        }
+        // Simple clock management: a thirtieth of the remaining time plus most of the increment
+        int side = (position.sideToMove == RED) ? 0 : 1;
+        if (remaining[side] > 0 && limits.moveTimeMs == 0) {
+            limits.moveTimeMs = std::max<int64_t>(1, remaining[side] / 30 + increment[side] * 4 / 5);
+        }
+
+        engine->clearStop();
+        Position root = position;
+        PositionHistory game = history;
+        searchThread = std::thread([this, root, game, limits]() {
+            SearchResult result = engine->think(root, limits, &game);
+            if (result.fromBook) send("info string book move");
+            send(result.hasMove ? "bestmove " + moveToString(result.bestMove) : "bestmove none");
+        });
+    }
+
+public:
+    ProtocolSession() : hashMegabytes(16), mctsThreads(0), position(initialPosition()) {
+        history.reset(hashPosition(position));
+        createEngine();
+    }
+
+    ~ProtocolSession() {
+        stopSearch();
+    }
+
+    int run(std::istream& in) {
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream tokens(line);
+            std::string command;
+            tokens >> command;
+            if (command == "checkers") {
+                send("id name Console Checkers");
+                send("option name Hash type spin default 16 min 1 max 65536");
+                send("option name Book type string default <empty>");
+                send("option name Tablebase type string default <empty>");
+                send("option name MCTS type spin default 0 min 0 max 256");
+                send("option name Network type string default <empty>");
+                send("checkersok");
+            } else if (command == "isready") {
+                send("readyok");
+            } else if (command == "setoption") {
+                handleSetOption(tokens);
+            } else if (command == "newgame") {
+                stopSearch();
+                engine->clearHash();
+                position = initialPosition();
+                history.reset(hashPosition(position));
+            } else if (command == "position") {
+                stopSearch();
+                handlePosition(tokens);
+            } else if (command == "go") {
+                handleGo(tokens);
+            } else if (command == "stop") {
+                stopSearch();
+            } else if (command == "quit") {
+                break;
+            } else if (!command.empty()) {
+                send("info string unknown command " + command);
+            }
+        }
+        stopSearch();
+        return 0;
+    }
+};
+
+// --- 16. GAME SESSION SERVER ---
+
+/**
+ * @struct GameSession
+ * @brief Compact value state of one hosted game (20 bytes, no heap).
+ */
+struct GameSession {
+    Position position;
+    uint16_t plies;
+    uint8_t result; // A GameResult; anything but RESULT_UNKNOWN means the game is over
+    uint8_t inUse;
+};
+
+/**
+ * @class SessionManager
+ * @brief Hosts many games as GameSession values and validates moves with the move generator.
+ *
+ * Line protocol, one reply line per request line:
+ *   new [POSITION]   -> "ok ID"
+ *   move ID MOVE     -> "ok" | "ok RESULT" when the move ends the game | "illegal"
+ *   moves ID         -> "moves M1 M2 ..."
+ *   show ID          -> "position POSITION"
+ *   end ID           -> "ok"
+ *   stats            -> "stats sessions N bytes-per-session B validated V rejected R moves-per-sec M"
+ * Unknown games and malformed requests are answered with "error ...".
+ */
+class SessionManager {
+private:
+    std::vector<GameSession> sessions; // Indexed by game id
+    std::vector<uint32_t> freeIds;
+    size_t activeCount;
+    uint64_t movesValidated;
+    uint64_t movesRejected;
+    std::chrono::steady_clock::time_point firstMoveTime;
+
+    // Splits off the next space-separated token
+    static bool nextToken(const char*& p, const char* end, const char*& token, size_t& length) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        token = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r') ++p;
+        length = (size_t)(p - token);
+        return length > 0;
+    }
+
+    GameSession* findSession(const char*& p, const char* end) {
+        const char* token;
+        size_t length;
+        if (!nextToken(p, end, token, length) || length > 9) return nullptr;
+        uint32_t id = 0;
+        for (size_t i = 0; i < length; ++i) {
+            if (token[i] < '0' || token[i] > '9') return nullptr;
+            id = id * 10 + (uint32_t)(token[i] - '0');
+        }
+        if (id >= sessions.size() || !sessions[id].inUse) return nullptr;
+        return &sessions[id];
+    }
+
+public:
+    explicit SessionManager(size_t expectedSessions)
+        : activeCount(0), movesValidated(0), movesRejected(0) {
+        sessions.reserve(expectedSessions);
+    }
+
+    uint32_t createSession(const Position& start) {
+        uint32_t id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        } else {
+            id = (uint32_t)sessions.size();
+            sessions.push_back(GameSession());
+        }
+        GameSession& session = sessions[id];
+        session.position = start;
+        session.plies = 0;
+        session.result = RESULT_UNKNOWN;
+        session.inUse = 1;
+        ++activeCount;
+        return id;
+    }
+
+    void endSession(uint32_t id) {
+        sessions[id].inUse = 0;
+        freeIds.push_back(id);
+        --activeCount;
+    }
+
+    // Validates and plays one move; the side that cannot move afterwards has lost
+    bool play(GameSession& session, const char* text, size_t length) {
+        if (movesValidated + movesRejected == 0) firstMoveTime = std::chrono::steady_clock::now();
+        FullMove move;
+        if (session.result != RESULT_UNKNOWN || !parseMove(session.position, text, length, move)) {
+            ++movesRejected;
+            return false;
+        }
+        session.position = applyMove(session.position, move);
+        ++session.plies;
+        MoveList replies;
+        if (generateMoves(session.position, replies) == 0) {
+            session.result = (session.position.sideToMove == RED) ? RESULT_BLACK_WINS : RESULT_RED_WINS;
+        }
+        ++movesValidated;
+        return true;
+    }
+
+    size_t activeSessions() const { return activeCount; }
+
+    // Session slots in use (live or free for reuse) spread over the live games; reserved
+    // capacity that was never touched is not resident and is left out
+    double bytesPerSession() const {
+        size_t bytes = sessions.size() * sizeof(GameSession) + freeIds.size() * sizeof(uint32_t);
+        return activeCount ? (double)bytes / activeCount : 0.0;
+    }
+
+    uint64_t validated() const { return movesValidated; }
+
+    double movesPerSecond() const {
+        if (movesValidated + movesRejected == 0) return 0.0;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - firstMoveTime).count();
+        return seconds > 0 ? (movesValidated + movesRejected) / seconds : 0.0;
+    }
+
+    // Answers one request line; the reply (with its newline) is appended to 'reply'
+    void handle(const char* line, size_t length, std::string& reply) {
+        const char* p = line;
+        const char* end = line + length;
+        const char* command;
+        size_t commandLength;
+        if (!nextToken(p, end, command, commandLength)) return;
+        std::string name(command, commandLength);
+
+        if (name == "move") {
+            GameSession* session = findSession(p, end);
+            const char* move;
+            size_t moveLength;
+            if (!session) {
+                reply += "error unknown game\n";
+            } else if (!nextToken(p, end, move, moveLength)) {
+                reply += "error missing move\n";
+            } else if (!play(*session, move, moveLength)) {
+                reply += "illegal\n";
+            } else if (session->result != RESULT_UNKNOWN) {
+                reply += "ok ";
+                reply += resultToString((GameResult)session->result);
+                reply += '\n';
+            } else {
+                reply += "ok\n";
+            }
+        } else if (name == "new") {
+            Position start = initialPosition();
+            while (p < end && *p == ' ') ++p;
+            if (p < end && !parsePosition(p, (size_t)(end - p), start)) {
+                reply += "error invalid position\n";
+                return;
+            }
+            reply += "ok " + std::to_string(createSession(start)) + "\n";
+        } else if (name == "moves" || name == "show" || name == "end") {
+            GameSession* session = findSession(p, end);
+            if (!session) {
+                reply += "error unknown game\n";
+            } else if (name == "moves") {
+                MoveList moves;
+                if (session->result == RESULT_UNKNOWN) generateMoves(session->position, moves);
+                reply += "moves";
+                for (int i = 0; i < moves.count; ++i) reply += " " + moveToString(moves.moves[i]);
+                reply += '\n';
+            } else if (name == "show") {
+                reply += "position " + positionToString(session->position) + "\n";
+            } else {
+                endSession((uint32_t)(session - &sessions[0]));
+                reply += "ok\n";
+            }
+        } else if (name == "stats") {
+            std::ostringstream out;
+            out << "stats sessions " << activeCount << " bytes-per-session " << bytesPerSession() << " validated "
+                << movesValidated << " rejected " << movesRejected << " moves-per-sec " << (uint64_t)movesPerSecond()
+                << '\n';
+            reply += out.str();
+        } else {
+            reply += "error unknown command " + name + "\n";
+        }
+    }
+};
+
+#if defined(__linux__)
+const size_t SERVER_READ_BUDGET = 64 * 1024;  // Bytes read from one connection per wakeup
+const size_t SERVER_MAX_LINE = 4096;          // Longer request lines close the connection
+const size_t SERVER_OUTPUT_HIGH_WATER = 256 * 1024; // Pending replies that pause a connection
+
+/**
+ * @class SessionServer
+ * @brief Serves a SessionManager over a Unix stream socket from a single epoll loop.
+ *
+ * Besides the SessionManager requests a client may send "quit" to close its connection
+ * and "shutdown" to stop the server.
+ *
+ * One client cannot take the loop over or grow the server without bound: each wakeup
+ * reads at most SERVER_READ_BUDGET bytes from a connection, a connection whose unsent
+ * replies pass SERVER_OUTPUT_HIGH_WATER is neither read nor answered until they drain,
+ * and a line longer than SERVER_MAX_LINE closes the connection.
+ */
+class SessionServer {
+private:
+    struct Connection {
+        std::string input;  // Bytes received but not yet answered
+        std::string output; // Replies not yet accepted by the socket
+        uint32_t events;    // Events currently registered with epoll
+    };
+
+    std::string socketPath;
+    SessionManager manager;
+    int listenFd;
+    int epollFd;
+    bool shuttingDown;
+    std::map<int, Connection> connections;
+
+    void closeConnection(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections.erase(fd);
+    }
+
+    void acceptClients() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return; // EAGAIN: no more pending clients
+            epoll_event event = {};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.fd = fd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+            connections[fd].events = event.events;
+        }
+    }
+
+    // True when the line is exactly 'word', apart from surrounding blanks
+    static bool isCommand(const char* line, size_t length, const char* word) {
+        while (length > 0 && (*line == ' ' || *line == '\t')) {
+            ++line;
+            --length;
+        }
+        while (length > 0 && (line[length - 1] == ' ' || line[length - 1] == '\t' || line[length - 1] == '\r')) --length;
+        return length == std::strlen(word) && std::memcmp(line, word, length) == 0;
+    }
+
+    // A paused connection (too many unsent replies) only waits until it can write again
+    void updateEvents(int fd, Connection& connection) {
+        uint32_t events = connection.output.size() >= SERVER_OUTPUT_HIGH_WATER ? (uint32_t)EPOLLOUT
+                          : (uint32_t)(EPOLLIN | EPOLLRDHUP) | (connection.output.empty() ? 0u : (uint32_t)EPOLLOUT);
+        if (events == connection.events) return;
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+        connection.events = events;
+    }
+
+    // Answers complete lines until the pending output reaches the high-water mark; the
+    // rest stay in 'input'. False when the connection should be closed.
+    bool answerLines(Connection& connection) {
+        size_t start = 0;
+        size_t newline;
+        bool open = true;
+        while (connection.output.size() < SERVER_OUTPUT_HIGH_WATER &&
+               (newline = connection.input.find('\n', start)) != std::string::npos) {
+            const char* line = connection.input.data() + start;
+            size_t length = newline - start;
+            start = newline + 1;
+            if (length > SERVER_MAX_LINE || isCommand(line, length, "quit")) {
+                open = false;
+                break;
+            }
+            if (isCommand(line, length, "shutdown")) {
+                shuttingDown = true;
+                connection.output += "ok\n";
+                continue;
+            }
+            manager.handle(line, length, connection.output);
+        }
+        connection.input.erase(0, start);
+        // An unterminated line that is already too long can never become valid
+        if (connection.input.size() > SERVER_MAX_LINE && connection.input.find('\n') == std::string::npos) open = false;
+        return open;
+    }
+
+    // Sends as much pending output as the socket takes and answers lines that waited
+    // for it to drain; false when the client is gone
+    bool flush(int fd, Connection& connection) {
+        size_t sent = 0;
+        while (sent < connection.output.size()) {
+            ssize_t n = ::send(fd, connection.output.data() + sent, connection.output.size() - sent, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return false;
+            }
+            sent += (size_t)n;
+        }
+        connection.output.erase(0, sent);
+
+        bool open = true;
+        if (sent > 0 && connection.output.size() < SERVER_OUTPUT_HIGH_WATER && !connection.input.empty()) {
+            open = answerLines(connection);
+        }
+        updateEvents(fd, connection);
+        return open;
+    }
+
+    // Reads up to SERVER_READ_BUDGET bytes and answers the complete lines; false closes
+    // the connection. Level-triggered epoll reports the rest on the next round.
+    bool serve(int fd, Connection& connection) {
+        char buffer[16384];
+        bool open = true;
+        size_t received = 0;
+        while (received < SERVER_READ_BUDGET) {
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                connection.input.append(buffer, (size_t)n);
+                received += (size_t)n;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            open = false; // Orderly shutdown or error: answer what arrived, then close
+            break;
+        }
+        open = answerLines(connection) && open;
+        return flush(fd, connection) && open;
+    }
+
+public:
+    SessionServer(const std::string& path, size_t expectedSessions)
+        : socketPath(path), manager(expectedSessions), listenFd(-1), epollFd(-1), shuttingDown(false) {}
+
+    ~SessionServer() {
+        for (std::map<int, Connection>::iterator it = connections.begin(); it != connections.end(); ++it) ::close(it->first);
+        if (epollFd >= 0) ::close(epollFd);
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            ::unlink(socketPath.c_str());
+        }
+    }
+
+    bool open() {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) return false;
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+        ::unlink(socketPath.c_str()); // Stale socket from an earlier run
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) return false;
+        if (::bind(listenFd, (const sockaddr*)&address, sizeof(address)) != 0 || ::listen(listenFd, SOMAXCONN) != 0) {
+            ::close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) return false;
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = listenFd;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) == 0;
+    }
+
+    // Runs the event loop until a client sends "shutdown"
+    void run() {
+        epoll_event events[256];
+        while (!shuttingDown) {
+            int ready = epoll_wait(epollFd, events, 256, -1);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            for (int i = 0; i < ready; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptClients();
+                    continue;
+                }
+                std::map<int, Connection>::iterator it = connections.find(fd);
+                if (it == connections.end()) continue;
+                bool keep = true;
+                bool reading = (it->second.events & EPOLLIN) != 0;
+                if (reading && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) keep = serve(fd, it->second);
+                else if (events[i].events & EPOLLOUT) keep = flush(fd, it->second);
+                else if (events[i].events & (EPOLLHUP | EPOLLERR)) keep = false;
+                if (!keep) closeConnection(fd);
+            }
+        }
+    }
+
+    const SessionManager& sessions() const { return manager; }
+};
+#endif
+
+/**
+ * @struct LatencyHistogram
+ * @brief Log-linear latency histogram: 16 linear buckets per power of two of nanoseconds,
+ * so every percentile is accurate to about 6%.
+ */
+struct LatencyHistogram {
+    static const int SUB_BUCKETS = 16;
+    static const int BUCKETS = 64 * SUB_BUCKETS;
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t maxNanos;
+
+    LatencyHistogram() : counts(BUCKETS, 0), total(0), maxNanos(0) {}
+
+    static int bucketOf(uint64_t nanos) {
+        if (nanos < SUB_BUCKETS) return (int)nanos;
+        // nanos lies in [2^exponent, 2^(exponent+1))
+#if defined(__GNUC__)
+        int exponent = 63 - __builtin_clzll(nanos);
+#else
+        int exponent = 0;
+        while (nanos >> (exponent + 1)) ++exponent;
+#endif
+        int sub = (int)((nanos >> (exponent - 4)) & (SUB_BUCKETS - 1));
+        return (exponent - 3) * SUB_BUCKETS + sub;
+    }
+
+    // Upper edge of a bucket, reported for the percentiles that fall into it
+    static uint64_t bucketLimit(int bucket) {
+        if (bucket < SUB_BUCKETS) return (uint64_t)bucket;
+        int exponent = bucket / SUB_BUCKETS + 3;
+        uint64_t sub = (uint64_t)(bucket % SUB_BUCKETS);
+        return ((SUB_BUCKETS + sub + 1) << (exponent - 4)) - 1;
+    }
+
+    void record(uint64_t nanos) {
+        ++counts[bucketOf(nanos)];
+        ++total;
+        maxNanos = std::max(maxNanos, nanos);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        maxNanos = std::max(maxNanos, other.maxNanos);
+    }
+
+    uint64_t percentile(double fraction) const {
+        uint64_t rank = (uint64_t)std::ceil(fraction * total);
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank && seen > 0) return std::min(bucketLimit(i), maxNanos);
+        }
+        return maxNanos;
+    }
+};
+
+#if defined(__linux__)
+/**
+ * @class LoadClient
+ * @brief One simulated player connection: keeps its own game in sync with the server and
+ * plays random legal moves, timing each request's round trip.
+ */
+class LoadClient {
+private:
+    int fd;
+    std::string input; // Received bytes not yet consumed as a reply line
+    uint32_t gameId;
+    Position position;
+    int plies;
+
+    bool sendLine(const std::string& line) {
+        size_t sent = 0;
+        while (sent < line.size()) {
+            ssize_t n = ::send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            sent += (size_t)n;
+        }
+        return true;
+    }
+
+    bool readLine(std::string& line) {
+        size_t newline;
+        while ((newline = input.find('\n')) == std::string::npos) {
+            char buffer[4096];
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) return false;
+            input.append(buffer, (size_t)n);
+        }
+        line.assign(input, 0, newline);
+        input.erase(0, newline + 1);
+        return true;
+    }
+
+    bool request(const std::string& line, std::string& reply) {
+        return sendLine(line) && readLine(reply);
+    }
+
+    bool startGame() {
+        std::string reply;
+        if (!request("new\n", reply) || reply.compare(0, 3, "ok ") != 0) return false;
+        gameId = (uint32_t)std::strtoul(reply.c_str() + 3, nullptr, 10);
+        position = initialPosition();
+        plies = 0;
+        return true;
+    }
+
+public:
+    LoadClient() : fd(-1), gameId(0), position(initialPosition()), plies(0) {}
+
+    ~LoadClient() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool connect(const std::string& path) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) return false;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || ::connect(fd, (const sockaddr*)&address, sizeof(address)) != 0) return false;
+        return startGame();
+    }
+
+    // Plays one random legal move and records its round trip. Finished (or endless) games
+    // are ended on the server and replaced by a new one. Returns false on protocol errors.
+    bool playMove(RandomGenerator& rng, LatencyHistogram& latency) {
+        MoveList moves;
+        if (plies >= SELF_PLAY_MAX_PLIES || generateMoves(position, moves) == 0) {
+            std::string reply;
+            if (!request("end " + std::to_string(gameId) + "\n", reply) || reply != "ok") return false;
+            return startGame() && playMove(rng, latency);
+        }
+        const FullMove& move = moves.moves[rng.below(moves.count)];
+        std::string line = "move " + std::to_string(gameId) + " " + moveToString(move) + "\n";
+        std::string reply;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!request(line, reply)) return false;
+        latency.record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+
+        if (reply.compare(0, 2, "ok") != 0) return false; // The server rejected a legal move
+        position = applyMove(position, move);
+        ++plies;
+        return true;
+    }
+
+    std::string stats() {
+        std::string reply;
+        return request("stats\n", reply) ? reply : std::string();
+    }
+};
+#endif
+
+// --- 17. GAME MANAGER CLASS ---
+
+/**
+ * @class GameEventSink
+ * @brief Receives the captures, multi-jumps and promotions made by CheckersGame::executeMove(),
+ * so applying the rules never does any I/O itself.
+ */
+class GameEventSink {
+public:
+    virtual ~GameEventSink() {}
+
+    virtual void onCapture(int r, int c) = 0;
+    virtual void onMultiJump(Player player, int r, int c) = 0;
+    virtual void onKinged(Player player, int r, int c) = 0;
+};
+
+/**
+ * @class NullEventSink
+ * @brief Discards every event (simulation and batch play).
+ */
+class NullEventSink : public GameEventSink {
+public:
+    void onCapture(int, int) override {}
+    void onMultiJump(Player, int, int) override {}
+    void onKinged(Player, int, int) override {}
+};
+
+/**
+ * @class ConsoleEventSink
+ * @brief Announces events on the console for interactive play.
+ */
+class ConsoleEventSink : public GameEventSink {
+public:
+    void onCapture(int r, int c) override {
+        std::cout << "-> PIECE CAPTURED at " << (char)('A' + c) << r + 1 << "!" << std::endl;
+    }
+
+    void onMultiJump(Player player, int r, int c) override {
+        std::cout << "-> MULTI-JUMP AVAILABLE! Player " << (player == RED ? "RED" : "BLACK")
+                  << " must continue jumping from " << (char)('A' + c) << r + 1 << "." << std::endl;
+    }
+
+    void onKinged(Player player, int r, int c) override {
+        std::cout << "-> " << (player == RED ? "RED" : "BLACK") << " piece KINGED at " << (char)('A' + c) << r + 1 << "!" << std::endl;
+    }
+};
+
+/**
+ * @class CheckersGame
+ * @brief Manages the overall game flow, rules, and player turns.
+ */
+class CheckersGame {
+private:
+    Board board;
+    Player currentPlayer;
+    Tablebase* tablebase; // Optional endgame database (not owned)
+    Engine* engine;       // Optional computer opponent (not owned)
+    Player computerPlayer;
+    SearchLimits computerLimits;
+    bool positionLoaded; // run() starts from the loaded position instead of the opening
+    ConsoleEventSink consoleEvents;
+    GameEventSink* events; // Where executeMove() reports what happened (never null)
+    bool redrawInPlace;    // Redraw the board at the top of the terminal instead of scrolling
+    bool ponderEnabled;  // Search on a background thread while the human is typing
+    std::thread ponderThread;
+    std::mutex ponderMutex;      // Guards ponderResult between the ponder thread and run()
+    Position ponderRoot;         // Position the human is thinking about
+    SearchResult ponderResult;   // Latest completed ponder iteration
+
+    // Struct to represent a potential move/jump
+    struct Move {
+        int startR, startC, endR, endC;
+    };
+
+    // Where each turn began on the board's undo stack, so "undo" can roll whole turns back
+    struct TurnStart {
+        size_t historySize;
+        Player player;
+        Position position;
+    };
+    std::vector<TurnStart> turnStarts;
+    PositionHistory gameHistory; // One entry per turn start plus the current position
+
+    // Legal steps in the current position: every jump if there is one (jumps are
+    // mandatory), otherwise every simple move. Built once per position and shared by
+    // win detection, forced-jump detection and input validation.
+    std::vector<Move> legalMoves;
+    bool legalMovesValid;   // Cleared whenever the board or the side to move changes
+    bool legalMovesAreJumps;
+
+    // Helper function to check if coordinates are within the board bounds
+    bool isInBounds(int r, int c) const {
+        return r >= 0 && r < BOARD_SIZE && c >= 0 && c < BOARD_SIZE;
+    }
+
+    // Checks if a specific move is a valid *simple* (non-jump) move
+    bool isSimpleMoveValid(int r1, int c1, int r2, int c2) const {
+        Piece* piece = board.getPiece(r1, c1);
+        if (!piece || board.getPiece(r2, c2)) {
+            return false; // No piece at start or target is occupied
+        }
+
+        // Must move exactly one diagonal square
+        if (std::abs(r2 - r1) != 1 || std::abs(c2 - c1) != 1) {
+            return false;
+        }
+
+        // Check direction for non-kings
+        if (!piece->isKing) {
+            if (piece->owner == RED && (r2 - r1) > 0) return false; // Red must move up (smaller row index)
+            if (piece->owner == BLACK && (r2 - r1) < 0) return false; // Black must move down (larger row index)
+        }
+
+        return true;
+    }
+
+    // Checks if a specific move is a valid *jump* (capture) move
+    // This is the core logic for capturing
+    bool isJumpValid(int r1, int c1, int r2, int c2) const {
+        Piece* piece = board.getPiece(r1, c1);
+        if (!piece || board.getPiece(r2, c2)) {
+            return false; // No piece at start or target is occupied
+        }
+
+        // Must move exactly two diagonal squares
+        if (std::abs(r2 - r1) != 2 || std::abs(c2 - c1) != 2) {
+            return false;
+        }
+
+        // Calculate the position of the jumped piece
+        int jumpedR = (r1 + r2) / 2;
+        int jumpedC = (c1 + c2) / 2;
+        Piece* jumpedPiece = board.getPiece(jumpedR, jumpedC);
+
+        // Check if there is an opponent's piece to jump over
+        if (!jumpedPiece || jumpedPiece->owner == piece->owner || jumpedPiece->owner == NONE) {
+            return false;
+        }
+
+        // Check direction for non-kings
+        if (!piece->isKing) {
+            if (piece->owner == RED && (r2 - r1) > 0) return false; // Red must move up (smaller row index)
+            if (piece->owner == BLACK && (r2 - r1) < 0) return false; // Black must move down (larger row index)
+        }
+
+        return true;
+    }
+
+    // Finds all possible jumps for a single piece
+    std::vector<Move> getPossibleJumpsForPiece(int r, int c) const {
+        std::vector<Move> jumps;
+        Piece* piece = board.getPiece(r, c);
+        if (!piece) return jumps;
+
+        // Possible jump directions: (-2, -2), (-2, +2), (+2, -2), (+2, +2)
+        int directions[4][2] = {{-2, -2}, {-2, 2}, {2, -2}, {2, 2}};
+
+        for (int i = 0; i < 4; ++i) {
+            int r2 = r + directions[i][0];
+            int c2 = c + directions[i][1];
+
+            if (isInBounds(r2, c2) && isJumpValid(r, c, r2, c2)) {
+                jumps.push_back({r, c, r2, c2});
+            }
+        }
+        return jumps;
+    }
+
+    // Finds ALL possible jumps for the current player on the board
+    std::vector<Move> getAllPossibleJumps() const {
+        std::vector<Move> allJumps;
+        for (int r = 0; r < BOARD_SIZE; ++r) {
+            for (int c = 0; c < BOARD_SIZE; ++c) {
+                Piece* piece = board.getPiece(r, c);
+                if (piece && piece->owner == currentPlayer) {
+                    std::vector<Move> jumps = getPossibleJumpsForPiece(r, c);
+                    allJumps.insert(allJumps.end(), jumps.begin(), jumps.end());
+                }
+            }
+        }
+        return allJumps;
+    }
+
+    const std::vector<Move>& currentLegalMoves() {
+        if (!legalMovesValid) {
+            legalMoves = getAllPossibleJumps();
+            legalMovesAreJumps = !legalMoves.empty();
+            if (!legalMovesAreJumps) legalMoves = getAllPossibleSimpleMoves();
+            legalMovesValid = true;
+        }
+        return legalMoves;
+    }
+
+    bool isLegalMove(int r1, int c1, int r2, int c2) {
+        for (const Move& move : currentLegalMoves()) {
+            if (move.startR == r1 && move.startC == c1 && move.endR == r2 && move.endC == c2) return true;
+        }
+        return false;
+    }
+
+    // Finds all possible simple moves for the current player
+    std::vector<Move> getAllPossibleSimpleMoves() const {
+        std::vector<Move> allMoves;
+        for (int r = 0; r < BOARD_SIZE; ++r) {
+            for (int c = 0; c < BOARD_SIZE; ++c) {
+                Piece* piece = board.getPiece(r, c);
+                if (piece && piece->owner == currentPlayer) {
+                    // Check all 4 surrounding diagonal squares
+                    int directions[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+                    for (int i = 0; i < 4; ++i) {
+                        int r2 = r + directions[i][0];
+                        int c2 = c + directions[i][1];
+
+                        if (isInBounds(r2, c2) && isSimpleMoveValid(r, c, r2, c2)) {
+                            allMoves.push_back({r, c, r2, c2});
+                        }
+                    }
+                }
+            }
+        }
+        return allMoves;
+    }
+
+    // Helper to switch the current player
+    void switchPlayer() {
+        currentPlayer = (currentPlayer == RED) ? BLACK : RED;
+    }
+
+    // Executes the actual move, including kinging and capture
+    bool executeMove(int r1, int c1, int r2, int c2) {
+        legalMovesValid = false;
+
+        // 1. Perform the movement (a jump also lifts the captured piece, kept for undo)
+        board.makeMove(r1, c1, r2, c2);
+
+        // 2. Check for Capture (if it was a jump move)
+        if (std::abs(r2 - r1) == 2) {
+            events->onCapture((r1 + r2) / 2, (c1 + c2) / 2);
+
+            // 3. Check for multi-jump opportunity
+            if (!getPossibleJumpsForPiece(r2, c2).empty()) {
+                events->onMultiJump(currentPlayer, r2, c2);
+                // Force the same player to take another turn from the new position
+                return true;
+            }
+        }
+
+        // 4. Check for Kinging
+        Piece* piece = board.getPiece(r2, c2);
+        if (piece) {
+            if (piece->owner == RED && r2 == 0 && !piece->isKing) { // Red reaches Black's back rank
+                board.crownLastMoved();
+                events->onKinged(RED, r2, c2);
+            } else if (piece->owner == BLACK && r2 == BOARD_SIZE - 1 && !piece->isKing) { // Black reaches Red's back rank
+                board.crownLastMoved();
+                events->onKinged(BLACK, r2, c2);
+            }
+        }
+
+        // 5. Normal turn end
+        switchPlayer();
+        return false; // Turn is over
+    }
+
+    // Checks for win/loss condition (no more pieces or no more valid moves)
+    Player checkForWin() {
+        int redPieces = board.pieceCount(RED);
+        int blackPieces = board.pieceCount(BLACK);
+
+        if (redPieces == 0) return BLACK;
+        if (blackPieces == 0) return RED;
+
+        // With few pieces left the endgame database already knows the outcome
+        if (tablebase && redPieces + blackPieces <= tablebase->maxPieces()) {
+            int result;
+            if (tablebase->probe(positionFromBoard(board, currentPlayer), result)) {
+                if (result == TB_WIN) return currentPlayer;
+                if (result == TB_LOSS) return (currentPlayer == RED) ? BLACK : RED;
+            }
+        }
+
+        // Check if the current player has any possible moves (jumps or simple moves)
+        if (currentLegalMoves().empty()) {
+             // If the current player has no moves, the other player wins
+             return (currentPlayer == RED) ? BLACK : RED;
+        }
+
+        return NONE; // No winner yet
+    }
+
+    // Reason the game is drawn in the current position, or null while it goes on
+    const char* checkForDraw() const {
+        if (gameHistory.repetitions() >= 2) return "the same position occurred three times";
+        if (gameHistory.noProgress()) return "no capture or man move for too long";
+        return nullptr;
+    }
+
+    // Adds the current position to the game history; turns taken back by "undo" are dropped first
+    void recordPosition() {
+        Position current = positionFromBoard(board, currentPlayer);
+        gameHistory.truncate(turnStarts.size());
+        if (turnStarts.empty()) gameHistory.reset(hashPosition(current));
+        else gameHistory.push(hashPosition(current), irreversibleStep(turnStarts.back().position, current));
+    }
+
+    // Parses user input like "A3 to B4" into coordinates (r1, c1, r2, c2)
+    bool parseInput(const std::string& input, int& r1, int& c1, int& r2, int& c2) {
+        // Expected format: XN to YM (e.g., A6 to B5)
+        if (input.length() < 7) return false;
+
+        // Convert column letters (A-H) to index (0-7)
+        c1 = std::toupper(input[0]) - 'A';
+        r1 = input[1] - '1'; // Convert row digit (1-8) to index (0-7)
+
+        // Expected " to " at index 2
+        if (input.substr(2, 4) != " to ") return false;
+
+        c2 = std::toupper(input[6]) - 'A';
+        r2 = input[7] - '1';
+
+        // Final coordinate checks
+        if (!isInBounds(r1, c1) || !isInBounds(r2, c2)) {
+            return false;
+        }
+
+        // Check that the move is actually a move and not staying in place
+        if (r1 == r2 && c1 == c2) {
+            return false;
+        }
+
+        return true;
+    }
+
+    // Searches the human's position on a background thread while run() waits for input.
+    // The engine's principal variation predicts the human's move and the reply to it,
+    // and everything it searched stays in the transposition table for the real search.
+    void startPondering() {
+        if (!ponderEnabled || !engine) return;
+        ponderRoot = positionFromBoard(board, currentPlayer);
+        {
+            std::lock_guard<std::mutex> lock(ponderMutex);
+            ponderResult.hasMove = false;
+            ponderResult.pv.clear();
+        }
+        engine->setInfoCallback([this](const SearchResult& result) {
+            std::lock_guard<std::mutex> lock(ponderMutex);
+            ponderResult = result;
+        });
+        ponderThread = std::thread([this]() {
+            SearchResult result = engine->think(ponderRoot, SearchLimits(), &gameHistory);
+            std::lock_guard<std::mutex> lock(ponderMutex);
+            ponderResult = result;
+        });
+    }
+
+    void stopPondering() {
+        if (!ponderThread.joinable()) return;
+        engine->stop();
+        ponderThread.join();
+        engine->clearStop(); // The search may have finished before the stop arrived
+        engine->setInfoCallback(nullptr);
+    }
+
+    // Answers the "hint" command with the engine's best move for the human
+    void showHint() {
+        SearchResult hint;
+        if (ponderThread.joinable()) {
+            std::lock_guard<std::mutex> lock(ponderMutex);
+            hint = ponderResult;
+        } else if (engine) {
+            hint = engine->think(positionFromBoard(board, currentPlayer), computerLimits, &gameHistory);
+        } else {
+            std::cout << "Hints need a computer opponent (--computer)." << std::endl;
+            return;
+        }
+        if (!hint.hasMove) {
+            std::cout << "No hint yet, the engine is still thinking." << std::endl;
+            return;
+        }
+        const FullMove& move = hint.bestMove;
+        std::cout << "Hint: " << squareName(move.from) << " to " << squareName(move.path[0])
+                  << " [" << moveToString(move) << "]";
+        if (hint.depth > 0) std::cout << " (depth " << hint.depth << ", score " << hint.score << ")";
+        std::cout << std::endl;
+    }
+
+    // Takes the reply from the ponder search when the human played the predicted move
+    // and the background search got at least as far as the normal search would have.
+    bool ponderHit(const Position& pos, SearchResult& reply) {
+        std::lock_guard<std::mutex> lock(ponderMutex);
+        const SearchResult& pondered = ponderResult;
+        if (pondered.pv.size() < 2 || !(applyMove(ponderRoot, pondered.pv[0]) == pos)) return false;
+        if (computerLimits.maxDepth > 0 && pondered.depth - 1 < computerLimits.maxDepth) return false;
+        if (computerLimits.moveTimeMs > 0 && pondered.timeMs < computerLimits.moveTimeMs) return false;
+        if (computerLimits.maxNodes > 0 && pondered.nodes < computerLimits.maxNodes) return false;
+
+        reply.hasMove = true;
+        reply.bestMove = pondered.pv[1];
+        reply.score = -pondered.score;
+        reply.depth = pondered.depth - 1;
+        reply.pv.assign(pondered.pv.begin() + 1, pondered.pv.end());
+        ponderResult.pv.clear(); // A prediction is only good for one reply
+        return true;
+    }
+
+    // Takes back the steps already made in the current turn or, if there are none, the
+    // previous turn; against the computer it goes back to the human's previous turn.
+    bool undoTurn() {
+        size_t index = turnStarts.size() - 1;
+        if (board.historySize() == turnStarts[index].historySize) {
+            do {
+                if (index == 0) return false;
+                --index;
+            } while (engine && turnStarts[index].player == computerPlayer);
+        }
+        while (board.historySize() > turnStarts[index].historySize) board.unmakeMove();
+        currentPlayer = turnStarts[index].player;
+        legalMovesValid = false;
+        turnStarts.resize(index); // run() records the restarted turn again
+        return true;
+    }
+
+    // Lets the engine choose the moves for one side and plays them on the board
+    void playComputerMove() {
+        Position pos = positionFromBoard(board, currentPlayer);
+        SearchResult result;
+        bool pondered = ponderEnabled && ponderHit(pos, result);
+        if (!pondered) result = engine->think(pos, computerLimits, &gameHistory);
+        if (!result.hasMove) return; // checkForWin() has already caught this
+
+        const FullMove& move = result.bestMove;
+        std::cout << "\n--- Computer (" << (currentPlayer == RED ? "RED" : "BLACK") << ") plays "
+                  << squareName(move.from) << " to " << squareName(move.to) << " [" << moveToString(move) << "]"
+                  << (result.fromBook ? " from the opening book" : "")
+                  << (pondered ? " (predicted while you were thinking)" : "") << " ---" << std::endl;
+
+        // Replay the sequence one step at a time so captures and kinging are announced
+        int from = move.from;
+        for (int i = 0; i < move.pathLength; ++i) {
+            int to = move.path[i];
+            executeMove(squareRow(from), squareCol(from), squareRow(to), squareCol(to));
+            from = to;
+        }
+    }
+
+public:
+    CheckersGame() : currentPlayer(RED), tablebase(nullptr), engine(nullptr), computerPlayer(NONE), positionLoaded(false),
+                     events(&consoleEvents), redrawInPlace(false), ponderEnabled(false),
+                     legalMovesValid(false), legalMovesAreJumps(false) {}
+
+    ~CheckersGame() {
+        stopPondering();
+    }
+
+    // Starts the game from an arbitrary position instead of initializeBoard()
+    void setPosition(const Position& pos) {
+        setupBoard(board, pos);
+        currentPlayer = pos.sideToMove;
+        positionLoaded = true;
+        legalMovesValid = false;
+    }
+
+    // Hands one side over to the engine
+    void setComputerOpponent(Engine* computer, Player side, const SearchLimits& limits) {
+        engine = computer;
+        computerPlayer = side;
+        computerLimits = limits;
+    }
+
+    // Redirects rule events, e.g. to a NullEventSink for silent simulation; null restores the console
+    void setEventSink(GameEventSink* sink) {
+        events = sink ? sink : &consoleEvents;
+    }
+
+    // Draws every turn's board over the previous one using ANSI cursor movement
+    void setRedrawInPlace(bool enabled) {
+        redrawInPlace = enabled;
+    }
+
+    // Lets the computer opponent think on the human's time
+    void setPondering(bool enabled) {
+        ponderEnabled = enabled;
+    }
+
+    // Plies without a capture or man move after which the game is drawn (0: never)
+    void setNoProgressLimit(int plies) {
+        gameHistory.setNoProgressLimit(plies);
+    }
+
+    // Lets checkForWin() end the game as soon as the endgame database decides it
+    void setTablebase(Tablebase* tb) {
+        tablebase = tb;
+    }
+
+    void run() {
+        if (!positionLoaded) board.initializeBoard();
+        legalMovesValid = false;
+        std::cout << "===========================================" << std::endl;
+        std::cout << "      WELCOME TO C++ CONSOLE CHECKERS      " << std::endl;
+        std::cout << "===========================================" << std::endl;
+        std::cout << "Red (R) starts at the bottom. Black (B) at the top." << std::endl;
+        std::cout << "Input format: [COLROW] to [COLROW] (e.g., A6 to B5)" << std::endl;
+
+        while (true) {
+            board.displayBoard(redrawInPlace);
+            recordPosition();
+
+            Player winner = checkForWin();
+            if (winner != NONE) {
+                std::cout << "\n*******************************************" << std::endl;
+                std::cout << "        PLAYER " << (winner == RED ? "RED" : "BLACK") << " WINS!         " << std::endl;
+                std::cout << "*******************************************" << std::endl;
+                break;
+            }
+            const char* draw = checkForDraw();
+            if (draw) {
+                std::cout << "\n*******************************************" << std::endl;
+                std::cout << "        THE GAME IS DRAWN" << std::endl;
+                std::cout << "*******************************************" << std::endl;
+                std::cout << "(" << draw << ")" << std::endl;
+                break;
+            }
+
+            turnStarts.push_back({board.historySize(), currentPlayer, positionFromBoard(board, currentPlayer)});
+            if (engine && currentPlayer == computerPlayer) {
+                playComputerMove();
+                continue;
+            }
+
+            // Get available moves/jumps for the current player (already built by checkForWin())
+            currentLegalMoves();
+            bool jumpIsForced = legalMovesAreJumps;
+
+            std::cout << "\n--- Player " << (currentPlayer == RED ? "RED (R/K)" : "BLACK (B/k)") << "'s Turn ---" << std::endl;
+            if (jumpIsForced) {
+                std::cout << "!!! JUMP IS MANDATORY !!! You must take a jump. !!!" << std::endl;
+            }
+
+            std::string input;
+            int r1, c1, r2, c2;
+            bool turnComplete = false;
+            startPondering();
+
+            // Loop until a valid move is made
+            while (!turnComplete) {
+                std::cout << "Enter move (e.g., A6 to B5), 'hint', 'undo' or 'exit': ";
+                std::getline(std::cin, input);
+
+                if (input == "exit" || input == "quit") {
+                    stopPondering();
+                    std::cout << "Game exited by player." << std::endl;
+                    return;
+                }
+                if (input == "hint") {
+                    showHint();
+                    continue;
+                }
+                if (input == "undo") {
+                    if (undoTurn()) break; // Start the restored turn over
+                    std::cout << "Nothing to undo." << std::endl;
+                    continue;
+                }
+
+                // Parse user input
+                if (!parseInput(input, r1, c1, r2, c2)) {
+                    std::cout << "Invalid input format or coordinates. Try again (e.g., A6 to B5)." << std::endl;
+                    continue;
+                }
+
+                // Get the piece to move
+                Piece* piece = board.getPiece(r1, c1);
+
+                // 1. Basic checks
+                if (!piece || piece->owner != currentPlayer) {
+                    std::cout << "Invalid selection. That square is empty or doesn't belong to you." << std::endl;
+                    continue;
+                }
+
+                bool isJump = std::abs(r2 - r1) == 2;
+                bool moveIsValid = false;
+                bool keepJumping = false; // For multi-jumps
+
+                // 2. Main Logic: Check if move is valid based on rules
+                if (jumpIsForced) {
+                    if (isJump) {
+                        if (isLegalMove(r1, c1, r2, c2)) {
+                            moveIsValid = true;
+                            keepJumping = executeMove(r1, c1, r2, c2);
+                            turnComplete = !keepJumping;
+                        } else {
+                            std::cout << "Invalid jump. You must capture an opponent's piece." << std::endl;
+                        }
+                    } else {
+                        std::cout << "A jump is available and MUST be taken. Please enter a valid jump move." << std::endl;
+                    }
+                } else {
+                    // No jump is forced, so check for simple move
+                    if (isJump) {
+                        if (isLegalMove(r1, c1, r2, c2)) {
+                            moveIsValid = true;
+                            keepJumping = executeMove(r1, c1, r2, c2);
+                            turnComplete = !keepJumping;
+                        } else {
+                             std::cout << "Invalid jump (no opponent piece to capture)." << std::endl;
+                        }
+                    } else if (isLegalMove(r1, c1, r2, c2)) {
+                        moveIsValid = true;
+                        executeMove(r1, c1, r2, c2);
+                        turnComplete = true; // Simple move always ends the turn
+                    } else {
+                        std::cout << "Invalid simple move. Check diagonal movement and direction rules." << std::endl;
+                    }
+                }
+            }
+            stopPondering();
+        }
+    }
+};
+
+// --- 18. MAIN FUNCTION ---
+
+void printUsage(const char* program) {
+    std::cout << "Usage:\n"
+              << "  " << program << " [--fen POSITION] [--computer red|black] [--depth N] [--movetime MS] [--book FILE] [--tb FILE]\n"
+              << "        [--ponder] [--redraw] [--mcts THREADS] [--nnue FILE] [--eval FILE] [--draw-moves N]\n"
+              << "      Play a game, optionally against the engine (--ponder: think on the human's time,\n"
+              << "      --redraw: redraw the board in place with ANSI escapes, --draw-moves: moves each\n"
+              << "      without a capture or man move before the game is drawn, 0 for no limit)\n"
+              << "  " << program << " tbgen PIECES FILE [--threads N] [--memory-mb N]\n"
+              << "      Generate endgame tablebases up to PIECES pieces\n"
+              << "  " << program << " book-build FILE [--selfplay N] [--import GAMES] [--depth N] [--random-plies N] [--book-plies N]\n"
+              << "      Build an opening book from self-play and/or imported games\n"
+              << "  " << program << " selfplay FILE [--games N] [--depth N] [--random-plies N]\n"
+              << "      Write engine self-play games to a PDN file\n"
+              << "  " << program << " datagen FILE [--games N] [--threads N] [--depth N] [--nodes N] [--random-plies N] [--hash MB]\n"
+              << "      Append scored self-play positions to a training-record file\n"
+              << "  " << program << " tune DATA OUT [--epochs N] [--threads N] [--batch N] [--rate X] [--lambda X] [--init FILE]\n"
+              << "      Fit the evaluation weights to a training-record file with Adam and write them to OUT\n"
+              << "      (--lambda blends search scores (1) and game results (0) as targets)\n"
+              << "  " << program << " pdn-stats FILE [--threads N]\n"
+              << "      Parse and validate a PDN archive in parallel and report throughput\n"
+              << "  " << program << " index-build ARCHIVE INDEX [--threads N] [--memory-mb N]\n"
+              << "      Index every position of a PDN archive by hash\n"
+              << "  " << program << " index-query INDEX POSITION\n"
+              << "      List the archived games that reached a position\n"
+              << "  " << program << " match ENGINE1 ENGINE2 [--games N] [--threads N] [--openings PDN | --opening-plies N]\n"
+              << "        [--elo0 E] [--elo1 E] [--alpha A] [--beta B] [--results FILE]\n"
+              << "      Play two engine configs (e.g. \"name=new,depth=8,hash=32,book=FILE,tb=FILE,nnue=FILE,eval=FILE\")\n"
+              << "      against each other with colour-reversed opening pairs until the SPRT decides\n"
+              << "      (mcts=THREADS selects Monte Carlo tree search; nodes= then counts playouts)\n"
+              << "  " << program << " analyze POSITION|startpos [--depth N] [--movetime MS] [--threads N] [--hash MB] [--tb FILE]\n"
+              << "      Score every legal move (multi-PV), streaming each move's score and PV as it improves\n"
+              << "  " << program << " batch [FILE|-] [--out FILE] [--depth N] [--nodes N] [--threads N] [--hash MB]\n"
+              << "      Search every position string of FILE (or stdin) on all cores; results come out in input order\n"
+              << "  " << program << " engine\n"
+              << "      Speak the line-based engine protocol on stdin/stdout (send \"checkers\" first)\n"
+              << "  " << program << " serve SOCKET [--sessions N]\n"
+              << "      Host many games over a Unix socket line protocol (new/move/moves/show/end/stats)\n"
+              << "  " << program << " loadtest SOCKET [--clients N] [--threads N] [--moves N]\n"
+              << "      Play random legal games against a running server and report round-trip latency\n"
+              << "  " << program << " bench fen [COUNT]\n"
+              << "      Check position-string round trips and measure parse/serialize throughput\n"
+              << "  " << program << " bench makeunmake [COUNT]\n"
+              << "      Check Board make/unmake against the move generator and measure pairs per second\n"
+              << "  " << program << " bench board32 [COUNT]\n"
+              << "      Check the 32-square board backend against Position and compare move generation speed\n"
+              << "  " << program << " bench eval [COUNT]\n"
+              << "      Check incremental evaluation and hashing against full recomputation and compare throughput\n"
+              << "  " << program << " bench nnue [COUNT] [--weights FILE]\n"
+              << "      Check the network's incremental and SIMD paths and measure evals per second\n";
+}
+
+// Value that follows 'name' on the command line, or 'fallback' when it is absent
+std::string optionValue(const std::vector<std::string>& args, const std::string& name, const std::string& fallback) {
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        if (args[i] == name) return args[i + 1];
+    }
+    return fallback;
+}
+
+int optionInt(const std::vector<std::string>& args, const std::string& name, int fallback) {
+    std::string value = optionValue(args, name, "");
+    return value.empty() ? fallback : std::atoi(value.c_str());
+}
+
+int runTablebaseGenerator(const std::vector<std::string>& args) {
+    int threads = optionInt(args, "--threads", (int)std::max(1u, std::thread::hardware_concurrency()));
+    uint64_t memoryMegabytes = (uint64_t)optionInt(args, "--memory-mb", 1024);
+    TablebaseGenerator generator(std::atoi(args[1].c_str()), threads, memoryMegabytes, args[2]);
+    if (!generator.generate() || !generator.write(args[2])) {
+        std::cerr << "Could not write " << args[2] << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int runBookBuilder(const std::vector<std::string>& args) {
+    OpeningBookBuilder builder(optionInt(args, "--book-plies", 16));
+
+    std::string importPath = optionValue(args, "--import", "");
+    if (!importPath.empty()) {
+        MappedFile archive;
+        if (!archive.open(importPath)) {
+            std::cerr << "Could not open " << importPath << std::endl;
+            return 1;
+        }
+        std::cout << "Imported " << builder.importPdn(archive) << " games from " << importPath << std::endl;
+    }
+
+    int games = optionInt(args, "--selfplay", 0);
+    if (games > 0) {
+        SearchLimits limits;
+        limits.maxDepth = optionInt(args, "--depth", 6);
+        int randomPlies = optionInt(args, "--random-plies", 4);
+        std::unique_ptr<Engine> engine(new Engine());
+        RandomGenerator rng((uint64_t)std::chrono::steady_clock::now().time_since_epoch().count());
+        int tally[4] = {0, 0, 0, 0};
+        for (int g = 0; g < games; ++g) {
+            GameRecord game = playSelfPlayGame(*engine, limits, randomPlies, rng);
+            builder.addGame(game);
+            tally[game.result]++;
+        }
+        std::cout << "Self-play: " << games << " games, RED " << tally[RESULT_RED_WINS] << " BLACK "
+                  << tally[RESULT_BLACK_WINS] << " draws " << tally[RESULT_DRAW] << std::endl;
+    }
+
+    if (!builder.write(args[1])) {
+        std::cerr << "Could not write " << args[1] << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << builder.size() << " book entries to " << args[1] << std::endl;
+    return 0;
+}
+
+// Positions sampled from random games, used as realistic benchmark input
+std::vector<Position> randomGamePositions(size_t count, uint64_t seed) {
+    std::vector<Position> positions;
+    positions.reserve(count);
+    RandomGenerator rng(seed);
+    while (positions.size() < count) {
+        Position pos = initialPosition();
+        MoveList moves;
+        for (int ply = 0; ply < SELF_PLAY_MAX_PLIES && positions.size() < count && generateMoves(pos, moves) > 0; ++ply) {
+            pos = applyMove(pos, moves.moves[rng.below(moves.count)]);
+            positions.push_back(pos);
+        }
+    }
+    return positions;
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int benchPositionStrings(size_t count) {
+    std::vector<Position> positions = randomGamePositions(count, 29);
+    std::vector<char> text(count * MAX_POSITION_STRING);
+    std::vector<size_t> lengths(count);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        lengths[i] = formatPosition(positions[i], &text[i * MAX_POSITION_STRING]);
+    }
+    double formatSeconds = secondsSince(start);
+
+    size_t mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        Position parsed;
+        if (!parsePosition(&text[i * MAX_POSITION_STRING], lengths[i], parsed) || !(parsed == positions[i])) ++mismatches;
+    }
+    double parseSeconds = secondsSince(start);
+
+    std::cout << "Position strings: " << count << " positions, " << mismatches << " round-trip mismatches\n"
+              << "  serialize: " << count / formatSeconds / 1e6 << " M positions/s\n"
+              << "  parse:     " << count / parseSeconds / 1e6 << " M positions/s" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Plays every legal move of random positions on a Board and takes it back again, checking
+// each result against applyMove() and each restored board against the original position
+int benchMakeUnmake(size_t count) {
+    const int REPEATS = 64;
+    std::vector<Position> positions = randomGamePositions(4096, 35);
+    Board board;
+    size_t pairs = 0;
+    size_t mismatches = 0;
+    double seconds = 0;
+
+    for (size_t p = 0; pairs < count; p = (p + 1) % positions.size()) {
+        const Position& pos = positions[p];
+        MoveList moves;
+        if (generateMoves(pos, moves) == 0) continue;
+        setupBoard(board, pos);
+        for (int i = 0; i < moves.count; ++i) {
+            makeBoardMove(board, moves.moves[i]);
+            if (!(positionFromBoard(board, opponentOf(pos.sideToMove)) == applyMove(pos, moves.moves[i]))) ++mismatches;
+            for (int step = 0; step < moves.moves[i].pathLength; ++step) board.unmakeMove();
+            if (!(positionFromBoard(board, pos.sideToMove) == pos)) ++mismatches;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int r = 0; r < REPEATS; ++r) {
+            for (int i = 0; i < moves.count; ++i) {
+                makeBoardMove(board, moves.moves[i]);
+                for (int step = 0; step < moves.moves[i].pathLength; ++step) board.unmakeMove();
+            }
+        }
+        seconds += secondsSince(start);
+        pairs += (size_t)REPEATS * moves.count;
+    }
+
+    std::cout << "Board make/unmake: " << pairs << " moves, " << mismatches << " mismatches\n"
+              << "  make+unmake: " << pairs / seconds / 1e6 << " M pairs/s" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Compares move generation and copy-make on SquareBoard with the bitboard Position,
+// checking that both produce the same moves in the same order and the same results
+int benchSquareBoard(size_t count) {
+    std::vector<Position> positions = randomGamePositions(count, 39);
+    std::vector<SquareBoard> boards(count);
+    for (size_t i = 0; i < count; ++i) boards[i] = SquareBoard::fromPosition(positions[i]);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; ++i) {
+        MoveList expected;
+        MoveList actual;
+        generateMoves(positions[i], expected);
+        boards[i].generateMoves(actual);
+        if (actual.count != expected.count || !(boards[i].toPosition() == positions[i])) {
+            ++mismatches;
+            continue;
+        }
+        for (int m = 0; m < actual.count; ++m) {
+            const FullMove& a = actual.moves[m];
+            const FullMove& e = expected.moves[m];
+            SquareBoard next = boards[i];
+            next.makeMove(a);
+            Position expectedNext = applyMove(positions[i], e);
+            if (a.from != e.from || a.to != e.to || a.captures != e.captures || !(next.toPosition() == expectedNext) ||
+                next.pieceCounts[RED] != popCount(expectedNext.red) || next.pieceCounts[BLACK] != popCount(expectedNext.black)) {
+                ++mismatches;
+            }
+        }
+    }
+
+    // Generate the moves of every position and play each of them with copy-make
+    uint64_t checksum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        MoveList moves;
+        generateMoves(positions[i], moves);
+        for (int m = 0; m < moves.count; ++m) checksum += applyMove(positions[i], moves.moves[m]).occupied();
+    }
+    double bitboardSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        MoveList moves;
+        boards[i].generateMoves(moves);
+        for (int m = 0; m < moves.count; ++m) {
+            SquareBoard next = boards[i];
+            next.makeMove(moves.moves[m]);
+            checksum += next.pieceCounts[RED];
+        }
+    }
+    double squareSeconds = secondsSince(start);
+
+    std::cout << "SquareBoard: " << count << " positions, " << mismatches << " mismatches against Position"
+              << " (checksum " << (checksum & 0xFF) << ")\n"
+              << "  bitboard Position: " << count / bitboardSeconds / 1e6 << " M positions/s\n"
+              << "  32-square board:   " << count / squareSeconds / 1e6 << " M positions/s" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Walks random games and evaluates every position twice: from scratch with
+// Evaluator::compute() and incrementally from the previous position with update()
+int benchEvaluation(size_t count) {
+    std::vector<Position> positions;
+    std::vector<FullMove> moves; // moves[i] leads from positions[i] to positions[i + 1]
+    positions.reserve(count + 1);
+    moves.reserve(count);
+    RandomGenerator rng(44);
+    Position pos = initialPosition();
+    positions.push_back(pos);
+    while (moves.size() < count) {
+        MoveList legal;
+        if (generateMoves(pos, legal) == 0 || positions.size() % SELF_PLAY_MAX_PLIES == 0) {
+            pos = initialPosition(); // Start the next game; the chain restarts with a fresh compute()
+            positions.push_back(pos);
+            moves.push_back(FullMove());
+            moves.back().pathLength = 0;
+            continue;
+        }
+        moves.push_back(legal.moves[rng.below(legal.count)]);
+        pos = applyMove(pos, moves.back());
+        positions.push_back(pos);
+    }
+
+    const Evaluator& evaluator = DEFAULT_EVALUATOR;
+    int64_t fullSum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 1; i <= count; ++i) fullSum += evaluator.evaluate(positions[i]);
+    double fullSeconds = secondsSince(start);
+
+    int64_t incrementalSum = 0;
+    Evaluation eval = evaluator.compute(positions[0]);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 1; i <= count; ++i) {
+        eval = moves[i - 1].pathLength ? evaluator.update(eval, positions[i - 1], moves[i - 1]) : evaluator.compute(positions[i]);
+        incrementalSum += evaluator.score(eval, positions[i].sideToMove);
+    }
+    double incrementalSeconds = secondsSince(start);
+
+    size_t mismatches = 0;
+    eval = evaluator.compute(positions[0]);
+    for (size_t i = 1; i <= count; ++i) {
+        eval = moves[i - 1].pathLength ? evaluator.update(eval, positions[i - 1], moves[i - 1]) : evaluator.compute(positions[i]);
+        Evaluation full = evaluator.compute(positions[i]);
+        if (eval.material != full.material || std::memcmp(eval.patterns, full.patterns, sizeof(full.patterns)) != 0) ++mismatches;
+    }
+
+    // The search's incremental hash keys must match hashPosition() as well
+    size_t hashMismatches = 0;
+    uint64_t key = hashPosition(positions[0]);
+    for (size_t i = 1; i <= count; ++i) {
+        key = moves[i - 1].pathLength ? hashAfterMove(key, positions[i - 1], moves[i - 1], positions[i]) : hashPosition(positions[i]);
+        if (key != hashPosition(positions[i])) ++hashMismatches;
+    }
+
+    std::cout << "Evaluation: " << count << " positions, " << mismatches << " incremental/full mismatches, "
+              << hashMismatches << " hash mismatches" << (fullSum == incrementalSum ? "" : ", score sums differ") << "\n"
+              << "  full:        " << count / fullSeconds / 1e6 << " M evals/s\n"
+              << "  incremental: " << count / incrementalSeconds / 1e6 << " M evals/s" << std::endl;
+    return (mismatches == 0 && hashMismatches == 0 && fullSum == incrementalSum) ? 0 : 1;
+}
+
+// Checks the network's incremental accumulators against refresh() and its SIMD forward
+// pass against the scalar one, then compares incremental and full evaluation speed
+int benchNetwork(size_t count, const std::string& weights) {
+    std::unique_ptr<Network> network(new Network());
+    if (!weights.empty() && !network->load(weights)) {
+        std::cerr << "Could not load network " << weights << std::endl;
+        return 1;
+    }
+    std::vector<Position> positions;
+    std::vector<FullMove> moves; // moves[i] leads from positions[i] to positions[i + 1]
+    RandomGenerator rng(45);
+    Position pos = initialPosition();
+    while (moves.size() < count) {
+        MoveList legal;
+        if (generateMoves(pos, legal) == 0) {
+            pos = initialPosition();
+            continue;
+        }
+        positions.push_back(pos);
+        moves.push_back(legal.moves[rng.below(legal.count)]);
+        pos = applyMove(pos, moves.back());
+    }
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; ++i) {
+        Accumulator parent, child, fresh;
+        network->refresh(positions[i], parent);
+        network->update(parent, positions[i], moves[i], child);
+        Position next = applyMove(positions[i], moves[i]);
+        network->refresh(next, fresh);
+        if (std::memcmp(&child, &fresh, sizeof(child)) != 0 ||
+            network->evaluate(child, next.sideToMove) != network->evaluateScalar(child, next.sideToMove)) {
+            ++mismatches;
+        }
+    }
+
+    // Incremental: one update per move along the games, as the search does
+    int64_t checksum = 0;
+    Accumulator stack[2];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        if (i == 0 || !(positions[i] == applyMove(positions[i - 1], moves[i - 1]))) network->refresh(positions[i], stack[i & 1]);
+        network->update(stack[i & 1], positions[i], moves[i], stack[(i + 1) & 1]);
+        checksum += network->evaluate(stack[(i + 1) & 1], opponentOf(positions[i].sideToMove));
+    }
+    double incrementalSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) checksum -= network->evaluate(applyMove(positions[i], moves[i]));
+    double fullSeconds = secondsSince(start);
+
+#if defined(__AVX2__)
+    const char* path = "AVX2";
+#else
+    const char* path = "scalar";
+#endif
+    std::cout << "Network (" << path << "): " << count << " moves, " << mismatches << " mismatches"
+              << (checksum == 0 ? "" : ", incremental and full scores differ") << "\n"
+              << "  incremental: " << count / incrementalSeconds / 1e6 << " M evals/s\n"
+              << "  full:        " << count / fullSeconds / 1e6 << " M evals/s" << std::endl;
+    return (mismatches == 0 && checksum == 0) ? 0 : 1;
+}
+
+int runBench(const std::vector<std::string>& args) {
+    std::string which = args.size() > 1 ? args[1] : "";
+    size_t count = args.size() > 2 ? (size_t)std::strtoull(args[2].c_str(), nullptr, 10) : 1000000;
+    if (which == "fen") return benchPositionStrings(count);
+    if (which == "makeunmake") return benchMakeUnmake(count);
+    if (which == "board32") return benchSquareBoard(count);
+    if (which == "eval") return benchEvaluation(count);
+    if (which == "nnue") return benchNetwork(count, optionValue(args, "--weights", ""));
+    std::cerr << "Unknown benchmark: " << which << std::endl;
+    return 1;
+}
+
+int runSelfPlay(const std::vector<std::string>& args) {
+    PdnWriter writer(args[1]);
+    if (!writer.isOpen()) {
+        std::cerr << "Could not write " << args[1] << std::endl;
+        return 1;
+    }
+    SearchLimits limits;
+    limits.maxDepth = optionInt(args, "--depth", 6);
+    int games = optionInt(args, "--games", 100);
+    int randomPlies = optionInt(args, "--random-plies", 6);
+    std::unique_ptr<Engine> engine(new Engine());
+    RandomGenerator rng((uint64_t)std::chrono::steady_clock::now().time_since_epoch().count());
+    for (int g = 0; g < games; ++g) {
+        writer.write(playSelfPlayGame(*engine, limits, randomPlies, rng), "Self-play " + std::to_string(g + 1));
+    }
+    if (!writer.close()) {
+        std::cerr << "Could not write " << args[1] << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << games << " games to " << args[1] << std::endl;
+    return 0;
+}
+
+int runDataGen(const std::vector<std::string>& args) {
+    DataGenOptions options;
+    options.threads = optionInt(args, "--threads", (int)std::max(1u, std::thread::hardware_concurrency()));
+    options.games = optionInt(args, "--games", options.games);
+    options.randomPlies = std::max(0, optionInt(args, "--random-plies", options.randomPlies));
+    options.hashMegabytes = optionInt(args, "--hash", options.hashMegabytes);
+    options.limits.maxDepth = optionInt(args, "--depth", options.limits.maxDepth);
+    options.limits.maxNodes = (uint64_t)optionInt(args, "--nodes", 0);
+
+    TrainingDataGenerator generator(options, args[1]);
+    auto start = std::chrono::steady_clock::now();
+    bool ok = generator.run(10, [](int games, uint64_t positions) {
+        std::cout << games << " games, " << positions << " positions" << std::endl;
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!ok) {
+        std::cerr << "Could not write " << args[1] << std::endl;
+        return 1;
+    }
+    std::cout << "Appended " << generator.positionsWritten() << " positions from " << generator.gamesPlayed() << " games to "
+              << args[1] << " in " << seconds << "s ("
+              << (uint64_t)(seconds > 0.0 ? generator.positionsWritten() * 3600.0 / seconds : 0.0) << " positions/hour)"
+              << std::endl;
+    return 0;
+}
+
+int runTune(const std::vector<std::string>& args) {
+    TuneOptions options;
+    options.threads = optionInt(args, "--threads", (int)std::max(1u, std::thread::hardware_concurrency()));
+    options.epochs = optionInt(args, "--epochs", options.epochs);
+    options.batchSize = (size_t)std::max(1, optionInt(args, "--batch", (int)options.batchSize));
+    options.learningRate = std::atof(optionValue(args, "--rate", "1.0").c_str());
+    options.lambda = std::atof(optionValue(args, "--lambda", "0.5").c_str());
+
+    EvaluationTuner tuner;
+    if (!tuner.open(args[1])) {
+        std::cerr << "Could not open training data " << args[1] << std::endl;
+        return 1;
+    }
+    std::string initial = optionValue(args, "--init", "");
+    if (!initial.empty()) {
+        std::unique_ptr<Evaluator> weights(new Evaluator());
+        if (!weights->load(initial)) {
+            std::cerr << "Could not load evaluation weights " << initial << std::endl;
+            return 1;
+        }
+        tuner.setInitialWeights(*weights);
+    }
+
+    std::cout << "Tuning on " << tuner.size() << " positions with " << options.threads << " threads, initial loss "
+              << tuner.meanLoss(options) << std::endl;
+    tuner.tune(options, [](int epoch, double loss, double rate) {
+        std::cout << "Epoch " << epoch << ": loss " << loss << ", " << (uint64_t)rate << " positions/s" << std::endl;
+    });
+    if (!tuner.result().save(args[2])) {
+        std::cerr << "Could not write " << args[2] << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote evaluation weights to " << args[2] << std::endl;
+    return 0;
+}
+
+/**
+ * @struct PdnStatistics
+ * @brief PdnReader visitor that only counts what it sees.
+ */
+struct PdnStatistics {
+    uint64_t games;
+    uint64_t invalidGames;
+    uint64_t positions;
+
+    void beginGame(const Position&) {}
+    void onMove(const Position&, const FullMove&, const Position&) { ++positions; }
+
+    void endGame(GameResult, bool valid) {
+        ++games;
+        if (!valid) ++invalidGames;
+    }
+};
+
+int runPdnStats(const std::vector<std::string>& args) {
+    MappedFile archive;
+    if (!archive.open(args[1])) {
+        std::cerr << "Could not open " << args[1] << std::endl;
+        return 1;
+    }
+    int threads = optionInt(args, "--threads", (int)std::max(1u, std::thread::hardware_concurrency()));
+    const char* text = (const char*)archive.data();
+    std::vector<const char*> bounds = splitPdnChunks(text, text + archive.size(), std::max(threads, 1));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<PdnStatistics> stats(bounds.size() - 1, PdnStatistics());
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+        workers.push_back(std::thread([&bounds, &stats, i]() {
+            PdnReader reader(bounds[i], bounds[i + 1]);
+            while (reader.readGame(stats[i])) {}
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+    double seconds = secondsSince(start);
+
+    PdnStatistics total = {0, 0, 0};
+    for (size_t i = 0; i < stats.size(); ++i) {
+        total.games += stats[i].games;
+        total.invalidGames += stats[i].invalidGames;
+        total.positions += stats[i].positions;
+    }
+    std::cout << total.games << " games (" << total.invalidGames << " with illegal moves), " << total.positions
+              << " positions in " << seconds << "s on " << workers.size() << " threads: "
+              << (uint64_t)(total.games / seconds * 60.0) << " games/min" << std::endl;
+    return 0;
+}
+
+int runIndexBuild(const std::vector<std::string>& args) {
+    MappedFile archive;
+    if (!archive.open(args[1])) {
+        std::cerr << "Could not open " << args[1] << std::endl;
+        return 1;
+    }
+    int threads = optionInt(args, "--threads", (int)std::max(1u, std::thread::hardware_concurrency()));
+    PositionIndexBuilder builder(args[2], (size_t)optionInt(args, "--memory-mb", 1024), threads);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int64_t games = builder.build(archive, threads);
+    if (games < 0) {
+        std::cerr << "Could not write " << args[2] << std::endl;
+        return 1;
+    }
+    std::cout << "Indexed " << games << " games in " << secondsSince(start) << "s" << std::endl;
+    return 0;
+}
+
+int runIndexQuery(const std::vector<std::string>& args) {
+    PositionIndex index;
+    Position pos;
+    if (!index.open(args[1])) {
+        std::cerr << "Could not open index " << args[1] << std::endl;
+        return 1;
+    }
+    if (!parsePosition(args[2], pos)) {
+        std::cerr << "Invalid position string: " << args[2] << std::endl;
+        return 1;
+    }
+    std::vector<uint64_t> games;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!index.gamesReaching(pos, games)) {
+        std::cerr << "Corrupt postings list in index " << args[1] << std::endl;
+        return 1;
+    }
+    double micros = secondsSince(start) * 1e6;
+
+    std::cout << games.size() << " of " << index.gameCount() << " games reached this position (" << micros
+              << " us)" << std::endl;
+    for (size_t i = 0; i < games.size() && i < 50; ++i) std::cout << (i ? " " : "") << games[i];
+    if (!games.empty()) std::cout << (games.size() > 50 ? " ..." : "") << std::endl;
+    return 0;
+}
+
+double optionDouble(const std::vector<std::string>& args, const std::string& name, double fallback) {
+    std::string value = optionValue(args, name, "");
+    return value.empty() ? fallback : std::atof(value.c_str());
+}
+
+int runBatch(const std::vector<std::string>& args) {
+    SearchLimits limits;
+    limits.maxDepth = optionInt(args, "--depth", 0);
+    limits.maxNodes = (uint64_t)optionInt(args, "--nodes", 0);
+    if (limits.maxDepth <= 0 && limits.maxNodes == 0) limits.maxDepth = 8;
+    int threads = optionInt(args, "--threads", (int)std::max(1u, std::thread::hardware_concurrency()));
+    BatchAnalyzer analyzer(limits, threads, optionInt(args, "--hash", 16));
+
+    std::string inputPath = (args.size() >= 2 && args[1].compare(0, 2, "--") != 0) ? args[1] : "-";
+    std::ifstream file;
+    if (inputPath != "-") {
+        file.open(inputPath.c_str());
+        if (!file) {
+            std::cerr << "Could not open " << inputPath << std::endl;
+            return 1;
+        }
+    }
+    std::string outputPath = optionValue(args, "--out", "");
+    std::ofstream output;
+    if (!outputPath.empty()) {
+        output.open(outputPath.c_str());
+        if (!output) {
+            std::cerr << "Could not write " << outputPath << std::endl;
+            return 1;
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t count = analyzer.run(inputPath == "-" ? std::cin : file, outputPath.empty() ? std::cout : output);
+    double seconds = secondsSince(start);
+    std::cerr << "Analyzed " << count << " positions in " << seconds << "s ("
+              << (uint64_t)(seconds > 0.0 ? count / seconds : 0.0) << " positions/s, " << threads << " threads)" << std::endl;
+    if (!outputPath.empty() && !output) {
+        std::cerr << "Could not write " << outputPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int runAnalyze(const std::vector<std::string>& args) {
+    Position pos = initialPosition();
+    if (args[1] != "startpos" && !parsePosition(args[1], pos)) {
+        std::cerr << "Invalid position string: " << args[1] << std::endl;
+        return 1;
+    }
+    SearchLimits limits;
+    limits.maxDepth = optionInt(args, "--depth", 0);
+    limits.moveTimeMs = optionInt(args, "--movetime", 0);
+    if (limits.maxDepth <= 0 && limits.moveTimeMs <= 0) limits.maxDepth = 10;
+    int threads = optionInt(args, "--threads", (int)std::max(1u, std::thread::hardware_concurrency()));
+
+    MultiPvAnalyzer analyzer(threads, optionInt(args, "--hash", 64));
+    Tablebase tablebase;
+    std::string tablebasePath = optionValue(args, "--tb", "");
+    if (!tablebasePath.empty()) {
+        if (!tablebase.open(tablebasePath)) {
+            std::cerr << "Could not open tablebase " << tablebasePath << std::endl;
+            return 1;
+        }
+        analyzer.setTablebase(&tablebase);
+    }
+    analyzer.setCallback([](const SearchResult& result) {
+        std::string line = "info move " + moveToString(result.bestMove) + " depth " + std::to_string(result.depth) +
+                           " score " + formatScore(result.score) + " pv";
+        for (size_t i = 0; i < result.pv.size(); ++i) line += " " + moveToString(result.pv[i]);
+        std::cout << line << '\n';
+        std::cout.flush();
+    });
+
+    std::vector<SearchResult> results = analyzer.analyze(pos, limits);
+    if (results.empty()) {
+        std::cout << "No legal moves" << std::endl;
+        return 0;
+    }
+    std::cout << "\nMove        Depth  Score\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        std::string move = moveToString(results[i].bestMove);
+        std::cout << move << std::string(move.size() < 12 ? 12 - move.size() : 1, ' ') << results[i].depth
+                  << (results[i].depth < 10 ? "      " : "     ") << formatScore(results[i].score) << '\n';
+    }
+    std::cout.flush();
+    return 0;
+}
+
+int runServe(const std::vector<std::string>& args) {
+#if defined(__linux__)
+    SessionServer server(args[1], (size_t)optionInt(args, "--sessions", 10000));
+    if (!server.open()) {
+        std::cerr << "Could not listen on " << args[1] << std::endl;
+        return 1;
+    }
+    std::cout << "Serving games on " << args[1] << std::endl;
+    server.run();
+    const SessionManager& sessions = server.sessions();
+    std::cout << "Shut down with " << sessions.activeSessions() << " sessions (" << sessions.bytesPerSession()
+              << " bytes each), " << sessions.validated() << " moves validated at " << sessions.movesPerSecond()
+              << " moves/s" << std::endl;
+    return 0;
+#else
+    std::cerr << "The session server needs Linux (epoll and Unix sockets)" << std::endl;
+    return 1;
+#endif
+}
+
+int runLoadTest(const std::vector<std::string>& args) {
+#if defined(__linux__)
+    int clientCount = std::max(1, optionInt(args, "--clients", 64));
+    int threadCount = std::max(1, std::min(clientCount, optionInt(args, "--threads", (int)std::thread::hardware_concurrency())));
+    uint64_t totalMoves = (uint64_t)std::max(1, optionInt(args, "--moves", 200000));
+
+    std::vector<std::unique_ptr<LoadClient> > clients;
+    for (int c = 0; c < clientCount; ++c) {
+        clients.emplace_back(new LoadClient());
+        if (!clients.back()->connect(args[1])) {
+            std::cerr << "Could not start a game on " << args[1] << std::endl;
+            return 1;
+        }
+    }
+
+    // Each thread drives its share of the clients round-robin, one request in flight per thread
+    std::vector<LatencyHistogram> latencies(threadCount);
+    std::atomic<uint64_t> nextMove(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> workers;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threadCount; ++t) {
+        workers.emplace_back([&, t]() {
+            RandomGenerator rng(0x9E3779B97F4A7C15ull * (uint64_t)(t + 1));
+            for (int c = t; !failed.load() && nextMove.fetch_add(1) < totalMoves; c += threadCount) {
+                if (c >= clientCount) c = t;
+                if (!clients[c]->playMove(rng, latencies[t])) failed.store(true);
+            }
+        });
+    }
+    for (size_t t = 0; t < workers.size(); ++t) workers[t].join();
+    double seconds = secondsSince(start);
+    if (failed.load()) {
+        std::cerr << "The server closed a connection or rejected a legal move" << std::endl;
+        return 1;
+    }
+
+    LatencyHistogram latency;
+    for (int t = 0; t < threadCount; ++t) latency.merge(latencies[t]);
+    std::cout << clientCount << " clients on " << threadCount << " threads played " << latency.total << " moves in "
+              << seconds << " s (" << latency.total / seconds << " moves/s)\n"
+              << "  round trip p50 " << latency.percentile(0.5) / 1000.0 << " us, p99 " << latency.percentile(0.99) / 1000.0
+              << " us, p999 " << latency.percentile(0.999) / 1000.0 << " us, max " << latency.maxNanos / 1000.0 << " us\n"
+              << "  server: " << clients[0]->stats() << std::endl;
+    return 0;
+#else
+    std::cerr << "The load generator needs Linux (Unix sockets)" << std::endl;
+    return 1;
+#endif
+}
+
+int runMatch(const std::vector<std::string>& args) {
+    EngineConfig first, second;
+    if (!first.parse(args[1]) || !second.parse(args[2])) {
+        std::cerr << "Invalid engine spec; expected e.g. \"name=new,depth=8\"" << std::endl;
+        return 1;
+    }
+
+    std::vector<GameRecord> openings;
+    std::string openingPath = optionValue(args, "--openings", "");
+    if (!openingPath.empty()) {
+        MappedFile file;
+        if (!file.open(openingPath)) {
+            std::cerr << "Could not open " << openingPath << std::endl;
+            return 1;
+        }
+        PdnReader reader((const char*)file.data(), (const char*)file.data() + file.size());
+        GameRecord game;
+        bool valid;
+        while (reader.nextGame(game, valid)) {
+            if (valid) openings.push_back(game);
+        }
+    } else {
+        openings = balancedOpenings(optionInt(args, "--opening-plies", 3), optionInt(args, "--balance", 60));
+    }
+    if (openings.empty()) {
+        std::cerr << "No openings to play" << std::endl;
+        return 1;
+    }
+
+    SprtTest sprt(optionDouble(args, "--elo0", 0.0), optionDouble(args, "--elo1", 10.0),
+                  optionDouble(args, "--alpha", 0.05), optionDouble(args, "--beta", 0.05));
+    std::string resultsPath = optionValue(args, "--results", "");
+    FILE* results = resultsPath.empty() ? nullptr : std::fopen(resultsPath.c_str(), "wb");
+    if (results) std::fwrite(MATCH_MAGIC, sizeof(MATCH_MAGIC), 1, results);
+
+    uint64_t pairs = (uint64_t)std::max(optionInt(args, "--games", 20000), 2) / 2;
+    int threads = optionInt(args, "--threads", (int)std::max(1u, std::thread::hardware_concurrency()));
+    std::cout << first.name << " vs " << second.name << ": " << openings.size() << " openings, up to " << 2 * pairs
+              << " games on " << threads << " threads" << std::endl;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Match match(first, second, openings, sprt, results, pairs);
+    match.run(threads);
+    if (results) std::fclose(results);
+
+    double score = sprt.meanScore();
+    double margin = (sprt.pairs() > 0) ? 1.96 * std::sqrt(sprt.variance() / sprt.pairs()) : 0.0;
+    const char* verdict = (sprt.decision() > 0) ? "H1 accepted" : (sprt.decision() < 0) ? "H0 accepted" : "inconclusive";
+    std::cout << "Finished " << 2 * sprt.pairs() << " games in " << secondsSince(start) << "s. " << first.name
+              << " scores " << 100.0 * score << "%, Elo " << scoreToElo(score) << " [" << scoreToElo(score - margin)
+              << ", " << scoreToElo(score + margin) << "], LLR " << sprt.llr() << ": " << verdict << std::endl;
+    return 0;
+}
+
+int runGame(const std::vector<std::string>& args, const char* program) {
+    Tablebase tablebase;
+    OpeningBook book;
+    std::unique_ptr<Engine> engine;
+    Player computer = NONE;
+    SearchLimits limits;
+    limits.moveTimeMs = 2000;
+    std::string fen;
+    bool ponder = false;
+    bool redraw = false;
+    int mctsThreads = 0;
+    int drawMoves = NO_PROGRESS_PLIES / 2;
+    std::unique_ptr<Network> network;
+    std::unique_ptr<Evaluator> evaluator;
+
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--ponder") {
+            ponder = true;
+            continue;
+        }
+        if (args[i] == "--redraw") {
+            redraw = true;
+            continue;
+        }
+        if (i + 1 >= args.size()) {
+            printUsage(program);
+            return 1;
+        }
+        const std::string& value = args[++i];
+        if (args[i - 1] == "--tb") {
+            if (!tablebase.open(value)) {
+                std::cerr << "Could not open tablebase " << value << std::endl;
+                return 1;
+            }
+        } else if (args[i - 1] == "--book") {
+            if (!book.open(value)) {
+                std::cerr << "Could not open opening book " << value << std::endl;
+                return 1;
+            }
+        } else if (args[i - 1] == "--computer") {
+            computer = (value == "red") ? RED : (value == "black") ? BLACK : NONE;
+        } else if (args[i - 1] == "--depth") {
+            limits.maxDepth = std::atoi(value.c_str());
+            limits.moveTimeMs = 0;
+        } else if (args[i - 1] == "--fen") {
+            fen = value;
+        } else if (args[i - 1] == "--movetime") {
+            limits.moveTimeMs = std::atoi(value.c_str());
+        } else if (args[i - 1] == "--mcts") {
+            mctsThreads = std::atoi(value.c_str());
+        } else if (args[i - 1] == "--draw-moves") {
+            drawMoves = std::max(0, std::atoi(value.c_str()));
+        } else if (args[i - 1] == "--nnue") {
+            network.reset(new Network());
+            if (!network->load(value)) {
+                std::cerr << "Could not load network " << value << std::endl;
+                return 1;
+            }
+        } else if (args[i - 1] == "--eval") {
+            evaluator.reset(new Evaluator());
+            if (!evaluator->load(value)) {
+                std::cerr << "Could not load evaluation weights " << value << std::endl;
+                return 1;
+            }
+        } else {
+            printUsage(program);
+            return 1;
+        }
+    }
+
+    // Create and run the game
+    CheckersGame game;
+    if (!fen.empty()) {
+        Position start;
+        if (!parsePosition(fen, start)) {
+            std::cerr << "Invalid position string: " << fen << std::endl;
+            return 1;
+        }
+        game.setPosition(start);
+    }
+    if (tablebase.isOpen()) game.setTablebase(&tablebase);
+    game.setRedrawInPlace(redraw);
+    game.setNoProgressLimit(2 * drawMoves);
+    if (computer != NONE) {
+        engine.reset(new Engine());
+        if (tablebase.isOpen()) engine->setTablebase(&tablebase);
+        if (book.isOpen()) engine->setBook(&book);
+        if (mctsThreads > 0) engine->setMonteCarlo(mctsThreads);
+        if (network) engine->setNetwork(network.get());
+        if (evaluator) engine->setEvaluator(evaluator.get());
+        game.setComputerOpponent(engine.get(), computer, limits);
+        game.setPondering(ponder);
+    }
+    game.run();
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Set standard output to not synchronize with C standard streams for better performance
+    std::ios_base::sync_with_stdio(false);
+
+    std::vector<std::string> args(argv + 1, argv + argc);
+    std::string command = args.empty() ? "" : args[0];
+
+    if (command == "tbgen" && args.size() >= 3) return runTablebaseGenerator(args);
+    if (command == "book-build" && args.size() >= 2) return runBookBuilder(args);
+    if (command == "bench") return runBench(args);
+    if (command == "selfplay" && args.size() >= 2) return runSelfPlay(args);
+    if (command == "datagen" && args.size() >= 2) return runDataGen(args);
+    if (command == "tune" && args.size() >= 3) return runTune(args);
+    if (command == "pdn-stats" && args.size() >= 2) return runPdnStats(args);
+    if (command == "index-build" && args.size() >= 3) return runIndexBuild(args);
+    if (command == "index-query" && args.size() >= 3) return runIndexQuery(args);
+    if (command == "match" && args.size() >= 3) return runMatch(args);
+    if (command == "analyze" && args.size() >= 2) return runAnalyze(args);
+    if (command == "batch") return runBatch(args);
+    if (command == "serve" && args.size() >= 2) return runServe(args);
+    if (command == "loadtest" && args.size() >= 2) return runLoadTest(args);
+    if (command == "engine") {
+        ProtocolSession session;
+        return session.run(std::cin);
+    }
+    if (command.empty() || command.compare(0, 2, "--") == 0) return runGame(args, argv[0]);
+
+    printUsage(argv[0]);
+    return 1;
+}